@@ -0,0 +1,327 @@
+/*
+ * Measures the hot paths of the add-on on the test host: cache files, guide
+ * ingest from power_guide, XMLTV loads and the playlist. Every case reports
+ * its throughput, the heap allocations per item and the peak RSS of the
+ * process so far.
+ *
+ * Usage: zattoo_bench [--quick] [directory]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <new>
+#include <set>
+#include <ftw.h>
+#include <sys/resource.h>
+#include "Cache.h"
+#include "FakeZattoo.h"
+#include "KodiHost.h"
+#include "Utils.h"
+#include "XmlTV.h"
+#include "ZatData.h"
+#include "categories.h"
+
+static std::atomic<uint64_t> allocations(0);
+
+void *operator new(size_t size)
+{
+  allocations++;
+  void *memory = malloc(size ? size : 1);
+  if (!memory)
+  {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+  free(memory);
+}
+
+struct Measurement
+{
+  std::chrono::steady_clock::time_point started;
+  uint64_t allocations;
+};
+
+static Measurement Begin()
+{
+  Measurement measurement;
+  measurement.allocations = allocations;
+  measurement.started = std::chrono::steady_clock::now();
+  return measurement;
+}
+
+static long PeakRssKb()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+static void Report(const char *name, uint64_t items,
+    const Measurement &measurement)
+{
+  double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - measurement.started).count();
+  uint64_t allocated = allocations - measurement.allocations;
+  printf("%-16s %9llu items %12.0f items/s %9.2f allocs/item %8ld KB peak RSS\n",
+      name, static_cast<unsigned long long>(items),
+      seconds > 0 ? items / seconds : 0.0,
+      items ? static_cast<double>(allocated) / items : 0.0, PeakRssKb());
+}
+
+static int RemoveEntry(const char *path, const struct stat *status, int flag,
+    struct FTW *ftw)
+{
+  return remove(path);
+}
+
+// Every case starts with an empty profile
+static void ResetProfile(const std::string &root)
+{
+  KodiHost::Stop();
+  nftw(root.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+  KodiHost::Start(root, ZATTOO_ADDON_DIR);
+  KodiHost::ResetCounters();
+}
+
+static ZatData *CreateZatData()
+{
+  return new ZatData("bench@example.com", "secret", false, false, "hls", 0,
+      "", true, 1);
+}
+
+// Utils::StringToTime before it parsed the string by hand
+static time_t SscanfStringToTime(const std::string &timeString)
+{
+  struct tm tm{};
+
+  int year, month, day, h, m, s, tzh, tzm;
+  if (sscanf(timeString.c_str(), "%d-%d-%dT%d:%d:%d%d", &year, &month, &day, &h,
+      &m, &s, &tzh) < 7)
+  {
+    tzh = 0;
+  }
+  tzm = tzh % 100;
+  tzh = tzh / 100;
+
+  tm.tm_year = year - 1900;
+  tm.tm_mon = month - 1;
+  tm.tm_mday = day;
+  tm.tm_hour = h - tzh;
+  tm.tm_min = m - tzm;
+  tm.tm_sec = s;
+
+  return timegm(&tm);
+}
+
+static bool BenchStringToTime(int count)
+{
+  const std::string times[] = { "2019-01-31T20:45:00Z",
+      "2019-01-31T20:45:00+0100", "2019-06-30T23:59:59.000Z" };
+  const int timeCount = sizeof(times) / sizeof(times[0]);
+
+  // Both agree on times without a colon in the offset
+  for (auto const &timeString : times)
+  {
+    if (Utils::StringToTime(timeString) != SscanfStringToTime(timeString))
+    {
+      printf("FAILED: %s is parsed as %lld instead of %lld\n",
+          timeString.c_str(),
+          static_cast<long long>(Utils::StringToTime(timeString)),
+          static_cast<long long>(SscanfStringToTime(timeString)));
+      return false;
+    }
+  }
+
+  // Keeps the compiler from dropping the calls
+  time_t sum = 0;
+  Measurement measurement = Begin();
+  for (int i = 0; i < count; i++)
+  {
+    sum += SscanfStringToTime(times[i % timeCount]);
+  }
+  Report("time sscanf", count, measurement);
+
+  measurement = Begin();
+  for (int i = 0; i < count; i++)
+  {
+    sum -= Utils::StringToTime(times[i % timeCount]);
+  }
+  Report("time parser", count, measurement);
+  return sum == 0;
+}
+
+static bool BenchCache(int count)
+{
+  time_t now;
+  time(&now);
+  std::string data(1024, 'x');
+
+  Measurement measurement = Begin();
+  for (int i = 0; i < count; i++)
+  {
+    // Half of the entries are already expired
+    Cache::Write("bench" + std::to_string(i), data, i % 2 ? now + 3600 : now - 1);
+  }
+  Report("cache write", count, measurement);
+
+  int hits = 0;
+  measurement = Begin();
+  for (int i = 0; i < count; i++)
+  {
+    std::string cached;
+    if (Cache::Read("bench" + std::to_string(i), cached))
+    {
+      hits++;
+    }
+  }
+  Report("cache read", count, measurement);
+
+  measurement = Begin();
+  Cache::Cleanup();
+  Report("cache cleanup", count, measurement);
+  return hits == count / 2;
+}
+
+static bool BenchEpg(int channelCount)
+{
+  FakeZattoo zattoo(channelCount, 0);
+  KodiHost::SetResponder(zattoo.GetResponder());
+  ZatData *zat = CreateZatData();
+  bool ready = zat->Initialize() && zat->LoadChannels();
+  zat->GetChannels(nullptr, false);
+  std::vector<unsigned int> uids = KodiHost::GetChannelUids();
+
+  time_t now;
+  time(&now);
+  KodiHost::ResetCounters();
+  Measurement measurement = Begin();
+  for (unsigned int uid : uids)
+  {
+    zat->GetEPGForChannelAsync(static_cast<int>(uid), now, now + 86400);
+  }
+  KodiHost::Counters counters = KodiHost::GetCounters();
+  uint64_t programmes = counters.epgEvents + counters.epgEntries;
+  Report("epg guide", programmes, measurement);
+  delete zat;
+  return ready && !uids.empty() && programmes >= uids.size() * 48;
+}
+
+static bool BenchXmlTV(const std::string &root, int channelCount, int days)
+{
+  const char *categories[] = { "Drama", "News", "Sports", "Comedy", "Kids" };
+  std::string path = root + "/bench.xml";
+  FILE *file = fopen(path.c_str(), "w");
+  if (!file)
+  {
+    return false;
+  }
+  time_t first;
+  time(&first);
+  first -= first % 1800;
+  fputs("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<tv>\n", file);
+  for (int i = 0; i < channelCount; i++)
+  {
+    for (int slot = 0; slot < days * 48; slot++)
+    {
+      time_t start = first + slot * 1800;
+      time_t stop = start + 1800;
+      char startTime[32];
+      char stopTime[32];
+      strftime(startTime, sizeof(startTime), "%Y%m%d%H%M%S +0000", gmtime(&start));
+      strftime(stopTime, sizeof(stopTime), "%Y%m%d%H%M%S +0000", gmtime(&stop));
+      fprintf(file, "  <programme start=\"%s\" stop=\"%s\" channel=\"%s\">\n"
+          "    <title>Programme %d</title>\n"
+          "    <sub-title>Episode %d</sub-title>\n"
+          "    <category>%s</category>\n"
+          "  </programme>\n", startTime, stopTime,
+          FakeZattoo::GetCid(i).c_str(), slot % 500, slot,
+          categories[slot % 5]);
+    }
+  }
+  fputs("</tv>\n", file);
+  fclose(file);
+
+  Categories genres;
+  XmlTV xmlTV(path, genres);
+  std::set<std::string> cids;
+  for (int i = 0; i < channelCount; i++)
+  {
+    cids.insert(FakeZattoo::GetCid(i));
+  }
+  xmlTV.SetChannels(cids);
+
+  std::vector<PVRIptvEpgEntry> entries;
+  Measurement measurement = Begin();
+  for (int i = 0; i < channelCount; i++)
+  {
+    xmlTV.GetEPGForChannel(FakeZattoo::GetCid(i), i + 1, first,
+        first + days * 86400, entries);
+  }
+  Report("xmltv load", entries.size(), measurement);
+  return !entries.empty();
+}
+
+static bool BenchRecordings(int recordingCount)
+{
+  FakeZattoo zattoo(10, recordingCount);
+  KodiHost::SetResponder(zattoo.GetResponder());
+  ZatData *zat = CreateZatData();
+  bool ready = zat->Initialize() && zat->LoadChannels();
+
+  KodiHost::ResetCounters();
+  Measurement measurement = Begin();
+  zat->GetRecordings(nullptr, false);
+  zat->GetRecordings(nullptr, true);
+  KodiHost::Counters counters = KodiHost::GetCounters();
+  uint64_t transferred = counters.recordings + counters.timers;
+  Report("recordings", transferred, measurement);
+  delete zat;
+  return ready && transferred == static_cast<uint64_t>(recordingCount);
+}
+
+int main(int argc, char *argv[])
+{
+  bool quick = false;
+  std::string root = "zattoo_bench";
+  for (int i = 1; i < argc; i++)
+  {
+    if (std::string(argv[i]) == "--quick")
+    {
+      quick = true;
+    }
+    else
+    {
+      root = argv[i];
+    }
+  }
+  // The quick run only checks that every case still works
+  int scale = quick ? 1 : 10;
+
+  bool success = BenchStringToTime(100000 * scale);
+  ResetProfile(root);
+  success = BenchCache(500 * scale) && success;
+  ResetProfile(root);
+  success = BenchEpg(20 * scale) && success;
+  ResetProfile(root);
+  success = BenchXmlTV(root, 20 * scale, quick ? 1 : 7) && success;
+  ResetProfile(root);
+  success = BenchRecordings(200 * scale) && success;
+  KodiHost::Stop();
+
+  if (!success)
+  {
+    printf("FAILED: a case did not produce the expected items\n");
+  }
+  return success ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+/*
+ * Runs the add-on against the fake Zattoo api: starts a session, loads
+ * channels, guide and recordings, then starts again from the recorded traffic
+ * alone.
+ */
+
+#include <cstdio>
+#include <ctime>
+#include <ftw.h>
+#include "Curl.h"
+#include "FakeZattoo.h"
+#include "KodiHost.h"
+#include "ZatData.h"
+
+const int channelCount = 20;
+const int recordingCount = 10;
+static int failures = 0;
+
+static void Check(bool condition, const char *description)
+{
+  printf("%s: %s\n", condition ? "ok" : "FAILED", description);
+  if (!condition)
+  {
+    failures++;
+  }
+}
+
+static int RemoveEntry(const char *path, const struct stat *status, int flag,
+    struct FTW *ftw)
+{
+  return remove(path);
+}
+
+static ZatData *CreateZatData()
+{
+  return new ZatData("bench@example.com", "secret", false, false, "hls", 0,
+      "", true, 1);
+}
+
+int main(int argc, char *argv[])
+{
+  std::string root = argc > 1 ? argv[1] : "zattoo_host_test";
+  nftw(root.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+  KodiHost::Start(root, ZATTOO_ADDON_DIR);
+  FakeZattoo zattoo(channelCount, recordingCount);
+  KodiHost::SetResponder(zattoo.GetResponder());
+  Curl::SetTrafficMode(TRAFFIC_RECORD, 0, 0);
+
+  time_t now;
+  time(&now);
+  ZatData *zat = CreateZatData();
+  Check(zat->Initialize(), "session is started");
+  Check(zat->LoadChannels(), "channels are loaded");
+  Check(zat->GetChannelsAmount() == channelCount, "all channels are known");
+  zat->GetChannels(nullptr, false);
+  std::vector<unsigned int> uids = KodiHost::GetChannelUids();
+  Check(!uids.empty(), "channels are transferred");
+  if (!uids.empty())
+  {
+    zat->GetEPGForChannelAsync(static_cast<int>(uids[0]), now, now + 86400);
+  }
+  Check(KodiHost::GetCounters().epgEvents >= 48,
+      "a day of guide data is transferred");
+  zat->GetRecordings(nullptr, false);
+  zat->GetRecordings(nullptr, true);
+  KodiHost::Counters counters = KodiHost::GetCounters();
+  Check(counters.recordings == recordingCount / 2u,
+      "finished recordings are transferred");
+  Check(counters.timers == recordingCount / 2u, "timers are transferred");
+  delete zat;
+
+  // The recorded traffic is enough to start again
+  KodiHost::SetResponder(nullptr);
+  Curl::SetTrafficMode(TRAFFIC_REPLAY, 0, 0);
+  zat = CreateZatData();
+  Check(zat->Initialize(), "session is started from recorded traffic");
+  Check(zat->LoadChannels() && zat->GetChannelsAmount() == channelCount,
+      "channels are loaded from recorded traffic");
+  delete zat;
+
+  KodiHost::Stop();
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,335 @@
+#include "FakeZattoo.h"
+#include <cstdlib>
+#include <sstream>
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+
+using namespace rapidjson;
+
+constexpr char POWER_HASH[] = "benchhash";
+const time_t programDuration = 1800;
+const char *genres[] = { "Drama", "News/Nachrichten", "Entertainment",
+    "Comedy", "Kids" };
+
+FakeZattoo::FakeZattoo(int channelCount, int recordingCount) :
+    m_channelCount(channelCount),
+    m_recordingCount(recordingCount)
+{
+  time(&m_created);
+}
+
+KodiHost::Responder FakeZattoo::GetResponder()
+{
+  return [this](const std::string& action, const std::string& url,
+      const std::string& postData, KodiHost::Response& response)
+  {
+    return Respond(action, url, postData, response);
+  };
+}
+
+std::string FakeZattoo::GetCid(int index)
+{
+  return "channel" + std::to_string(index);
+}
+
+int FakeZattoo::GetRequestCount(const std::string& path)
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  auto it = m_requestCounts.find(path);
+  return it == m_requestCounts.end() ? 0 : it->second;
+}
+
+bool FakeZattoo::Respond(const std::string& action, const std::string& url,
+    const std::string& postData, KodiHost::Response& response)
+{
+  // Strip the provider, all providers share the api
+  size_t pathStart = url.find('/', url.find("://") + 3);
+  std::string path = pathStart == std::string::npos ? "/" :
+      url.substr(pathStart);
+  std::string query;
+  size_t queryStart = path.find('?');
+  if (queryStart != std::string::npos)
+  {
+    query = path.substr(queryStart + 1);
+    path.resize(queryStart);
+  }
+  {
+    P8PLATFORM::CLockObject lock(m_mutex);
+    m_requestCounts[path]++;
+  }
+
+  std::string powerHashPath = std::string("/") + POWER_HASH;
+  if (path == "/")
+  {
+    response.body = "<script>window.appToken = 'benchtoken';</script>";
+  }
+  else if (path == "/zapi/session/hello")
+  {
+    response.body = "{\"success\": true}";
+    response.cookies.push_back("beaker.session.id=benchsession; Path=/");
+  }
+  else if (path == "/zapi/v2/session" || path == "/zapi/v2/account/login")
+  {
+    response.body = Session();
+  }
+  else if (path == "/zapi/channels/favorites")
+  {
+    response.body = Favorites();
+  }
+  else if (path == "/zapi/v2/cached/channels" + powerHashPath)
+  {
+    response.body = Channels();
+  }
+  else if (path == "/zapi/v2/cached/program/power_guide" + powerHashPath)
+  {
+    response.body = PowerGuide(atol(GetParameter(query, "start").c_str()),
+        atol(GetParameter(query, "end").c_str()));
+  }
+  else if (path == "/zapi/playlist")
+  {
+    response.body = Playlist();
+  }
+  else if (path == "/zapi/v2/cached/program/power_details" + powerHashPath)
+  {
+    response.body = PowerDetails(GetParameter(query, "program_ids"));
+  }
+  else if (path == "/zapi/watch")
+  {
+    response.body =
+        "{\"success\": true, \"stream\": {\"url\": \"http://localhost/stream.m3u8\"}}";
+  }
+  else
+  {
+    return false;
+  }
+  return true;
+}
+
+std::string FakeZattoo::GetParameter(const std::string& query,
+    const std::string& name)
+{
+  std::string key = name + "=";
+  size_t pos = 0;
+  while ((pos = query.find(key, pos)) != std::string::npos)
+  {
+    if (pos == 0 || query[pos - 1] == '&')
+    {
+      size_t end = query.find('&', pos);
+      return query.substr(pos + key.length(),
+          end == std::string::npos ? std::string::npos :
+              end - pos - key.length());
+    }
+    pos += key.length();
+  }
+  return "";
+}
+
+std::string FakeZattoo::Session()
+{
+  StringBuffer buffer;
+  Writer<StringBuffer> writer(buffer);
+  writer.StartObject();
+  writer.Key("success");
+  writer.Bool(true);
+  writer.Key("session");
+  writer.StartObject();
+  writer.Key("loggedin");
+  writer.Bool(true);
+  writer.Key("power_guide_hash");
+  writer.String(POWER_HASH);
+  writer.Key("aliased_country_code");
+  writer.String("CH");
+  writer.Key("service_region_country");
+  writer.String("CH");
+  writer.Key("recall_eligible");
+  writer.Bool(true);
+  writer.Key("recall_seconds");
+  writer.Int(7 * 86400);
+  writer.Key("selective_recall_eligible");
+  writer.Bool(false);
+  writer.Key("recording_eligible");
+  writer.Bool(true);
+  writer.EndObject();
+  writer.EndObject();
+  return buffer.GetString();
+}
+
+std::string FakeZattoo::Favorites()
+{
+  StringBuffer buffer;
+  Writer<StringBuffer> writer(buffer);
+  writer.StartObject();
+  writer.Key("success");
+  writer.Bool(true);
+  writer.Key("favorites");
+  writer.StartArray();
+  for (int i = 0; i < m_channelCount && i < 10; i++)
+  {
+    writer.String(GetCid(i).c_str());
+  }
+  writer.EndArray();
+  writer.EndObject();
+  return buffer.GetString();
+}
+
+std::string FakeZattoo::Channels()
+{
+  StringBuffer buffer;
+  Writer<StringBuffer> writer(buffer);
+  writer.StartObject();
+  writer.Key("success");
+  writer.Bool(true);
+  writer.Key("channel_groups");
+  writer.StartArray();
+  writer.StartObject();
+  writer.Key("name");
+  writer.String("All channels");
+  writer.Key("channels");
+  writer.StartArray();
+  for (int i = 0; i < m_channelCount; i++)
+  {
+    std::string cid = GetCid(i);
+    writer.StartObject();
+    writer.Key("cid");
+    writer.String(cid.c_str());
+    writer.Key("recording");
+    writer.Bool(true);
+    writer.Key("qualities");
+    writer.StartArray();
+    writer.StartObject();
+    writer.Key("availability");
+    writer.String("available");
+    writer.Key("title");
+    writer.String(("Channel " + std::to_string(i)).c_str());
+    writer.Key("logo_white_84");
+    writer.String(("/images/" + cid + ".png").c_str());
+    writer.EndObject();
+    writer.EndArray();
+    writer.EndObject();
+  }
+  writer.EndArray();
+  writer.EndObject();
+  writer.EndArray();
+  writer.EndObject();
+  return buffer.GetString();
+}
+
+std::string FakeZattoo::PowerGuide(time_t start, time_t end)
+{
+  StringBuffer buffer;
+  Writer<StringBuffer> writer(buffer);
+  writer.StartObject();
+  writer.Key("success");
+  writer.Bool(true);
+  writer.Key("channels");
+  writer.StartArray();
+  for (int i = 0; i < m_channelCount; i++)
+  {
+    writer.StartObject();
+    writer.Key("cid");
+    writer.String(GetCid(i).c_str());
+    writer.Key("programs");
+    writer.StartArray();
+    for (time_t programStart = start - start % programDuration;
+        programStart < end; programStart += programDuration)
+    {
+      int slot = static_cast<int>(programStart / programDuration % 1000000);
+      writer.StartObject();
+      writer.Key("id");
+      writer.Int(slot * 100 + i % 100);
+      writer.Key("t");
+      writer.String(("Programme " + std::to_string(slot % 500)).c_str());
+      writer.Key("s");
+      writer.Int64(programStart);
+      writer.Key("e");
+      writer.Int64(programStart + programDuration);
+      writer.Key("et");
+      writer.String(("Episode " + std::to_string(slot)).c_str());
+      writer.Key("i_url");
+      writer.String(("http://images.zattic.com/" + std::to_string(slot % 500)
+          + ".jpg").c_str());
+      writer.Key("g");
+      writer.StartArray();
+      writer.String(genres[slot % (sizeof(genres) / sizeof(genres[0]))]);
+      writer.EndArray();
+      writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+  }
+  writer.EndArray();
+  writer.EndObject();
+  return buffer.GetString();
+}
+
+std::string FakeZattoo::Playlist()
+{
+  StringBuffer buffer;
+  Writer<StringBuffer> writer(buffer);
+  writer.StartObject();
+  writer.Key("success");
+  writer.Bool(true);
+  writer.Key("recordings");
+  writer.StartArray();
+  for (int i = 0; i < m_recordingCount; i++)
+  {
+    // Alternate between finished recordings and scheduled ones
+    time_t start = m_created + (i % 2 ? 1 : -1) * (i + 1) * 3600;
+    char startTime[32];
+    char endTime[32];
+    time_t end = start + programDuration;
+    strftime(startTime, sizeof(startTime), "%Y-%m-%dT%H:%M:%SZ", gmtime(&start));
+    strftime(endTime, sizeof(endTime), "%Y-%m-%dT%H:%M:%SZ", gmtime(&end));
+    writer.StartObject();
+    writer.Key("id");
+    writer.Int(i + 1);
+    writer.Key("program_id");
+    writer.Int(100000 + i);
+    writer.Key("cid");
+    writer.String(GetCid(i % m_channelCount).c_str());
+    writer.Key("title");
+    writer.String(("Recording " + std::to_string(i)).c_str());
+    writer.Key("episode_title");
+    writer.String(("Episode " + std::to_string(i)).c_str());
+    writer.Key("image_url");
+    writer.String("http://images.zattic.com/recording.jpg");
+    writer.Key("start");
+    writer.String(startTime);
+    writer.Key("end");
+    writer.String(endTime);
+    writer.EndObject();
+  }
+  writer.EndArray();
+  writer.EndObject();
+  return buffer.GetString();
+}
+
+std::string FakeZattoo::PowerDetails(const std::string& programIds)
+{
+  StringBuffer buffer;
+  Writer<StringBuffer> writer(buffer);
+  writer.StartObject();
+  writer.Key("success");
+  writer.Bool(true);
+  writer.Key("programs");
+  writer.StartArray();
+  std::istringstream ids(programIds);
+  std::string id;
+  while (std::getline(ids, id, ','))
+  {
+    int programId = atoi(id.c_str());
+    writer.StartObject();
+    writer.Key("id");
+    writer.Int(programId);
+    writer.Key("d");
+    writer.String(("Description of programme " + id).c_str());
+    writer.Key("g");
+    writer.StartArray();
+    writer.String(genres[programId % (sizeof(genres) / sizeof(genres[0]))]);
+    writer.EndArray();
+    writer.EndObject();
+  }
+  writer.EndArray();
+  writer.EndObject();
+  return buffer.GetString();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <ctime>
+#include <map>
+#include <string>
+#include <p8-platform/threads/mutex.h>
+#include "KodiHost.h"
+
+/*!
+ * @brief Answers the Zattoo requests of the add-on with generated data
+ *
+ * Serves a logged in session, channelCount channels with a programme every
+ * half hour and a playlist of recordingCount recordings, half of them in the
+ * past and half in the future.
+ */
+class FakeZattoo
+{
+public:
+  FakeZattoo(int channelCount, int recordingCount);
+  bool Respond(const std::string& action, const std::string& url,
+      const std::string& postData, KodiHost::Response& response);
+  KodiHost::Responder GetResponder();
+  /*!
+   * @brief Number of requests for the path, e.g. /zapi/playlist
+   */
+  int GetRequestCount(const std::string& path);
+  static std::string GetCid(int index);
+
+private:
+  std::string Session();
+  std::string Channels();
+  std::string Favorites();
+  std::string PowerGuide(time_t start, time_t end);
+  std::string Playlist();
+  std::string PowerDetails(const std::string& programIds);
+  static std::string GetParameter(const std::string& query,
+      const std::string& name);
+
+  int m_channelCount;
+  int m_recordingCount;
+  time_t m_created;
+  std::map<std::string, int> m_requestCounts;
+  P8PLATFORM::CMutex m_mutex;
+};
@@ -0,0 +1,616 @@
+#include "KodiHost.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <unistd.h>
+#include <p8-platform/threads/mutex.h>
+
+using namespace ADDON;
+
+std::string g_strUserPath;
+std::string g_strClientPath;
+ADDON::CHelper_libXBMC_addon *XBMC = nullptr;
+CHelper_libXBMC_pvr *PVR = nullptr;
+
+constexpr char SPECIAL[] = "special://";
+constexpr char ADDON_DIR[] = "special://home/addons/pvr.zattoo/";
+
+/*!
+ * @brief A local file or the response of a http request
+ */
+struct HostFile
+{
+  FILE *file = nullptr;
+  std::string url;
+  std::string action = "GET";
+  std::string postData;
+  KodiHost::Response response;
+  size_t position = 0;
+};
+
+static std::string s_root;
+static std::string s_addonDir;
+static KodiHost::Responder s_responder;
+static P8PLATFORM::CMutex s_mutex;
+static std::atomic<int> s_logLevel(LOG_ERROR);
+static std::atomic<uint64_t> s_requests(0);
+static std::atomic<uint64_t> s_failedRequests(0);
+static std::atomic<uint64_t> s_epgEvents(0);
+static std::atomic<uint64_t> s_epgEntries(0);
+static std::atomic<uint64_t> s_channels(0);
+static std::atomic<uint64_t> s_recordings(0);
+static std::atomic<uint64_t> s_timers(0);
+static std::vector<unsigned int> s_channelUids;
+
+static std::string Base64Decode(const std::string& in)
+{
+  static const std::string chars =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  int value = 0;
+  int bits = -8;
+  for (char c : in)
+  {
+    size_t pos = chars.find(c);
+    if (pos == std::string::npos)
+    {
+      break;
+    }
+    value = (value << 6) + static_cast<int>(pos);
+    bits += 6;
+    if (bits >= 0)
+    {
+      out.push_back(static_cast<char>((value >> bits) & 0xFF));
+      bits -= 8;
+    }
+  }
+  return out;
+}
+
+static bool MakeDirectories(const std::string& path)
+{
+  for (size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1))
+  {
+    std::string parent = path.substr(0, pos);
+    if (mkdir(parent.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+      return false;
+    }
+    if (pos == std::string::npos)
+    {
+      return true;
+    }
+  }
+}
+
+static bool MatchesMask(const std::string& name, const std::string& mask)
+{
+  if (mask.empty())
+  {
+    return true;
+  }
+  // Kodi masks are extensions separated by '|'
+  size_t start = 0;
+  while (start <= mask.length())
+  {
+    size_t end = mask.find('|', start);
+    std::string extension = mask.substr(start,
+        end == std::string::npos ? std::string::npos : end - start);
+    if (!extension.empty() && name.length() >= extension.length()
+        && name.compare(name.length() - extension.length(),
+            extension.length(), extension) == 0)
+    {
+      return true;
+    }
+    if (end == std::string::npos)
+    {
+      break;
+    }
+    start = end + 1;
+  }
+  return false;
+}
+
+void KodiHost::Start(const std::string& root, const std::string& addonDir)
+{
+  s_root = root;
+  s_addonDir = addonDir;
+  MakeDirectories(s_root);
+  g_strUserPath = TranslatePath("special://profile/addon_data/pvr.zattoo");
+  g_strClientPath = addonDir;
+  XBMC = new ADDON::CHelper_libXBMC_addon;
+  PVR = new CHelper_libXBMC_pvr;
+}
+
+void KodiHost::Stop()
+{
+  delete XBMC;
+  XBMC = nullptr;
+  delete PVR;
+  PVR = nullptr;
+  SetResponder(nullptr);
+}
+
+void KodiHost::SetResponder(const Responder& responder)
+{
+  P8PLATFORM::CLockObject lock(s_mutex);
+  s_responder = responder;
+}
+
+void KodiHost::SetLogLevel(addon_log_t level)
+{
+  s_logLevel = level;
+}
+
+std::string KodiHost::TranslatePath(const std::string& path)
+{
+  // The add-on finds its resources in the source tree
+  if (path.compare(0, sizeof(ADDON_DIR) - 1, ADDON_DIR) == 0)
+  {
+    return s_addonDir + "/" + path.substr(sizeof(ADDON_DIR) - 1);
+  }
+  if (path.compare(0, sizeof(SPECIAL) - 1, SPECIAL) == 0)
+  {
+    return s_root + "/" + path.substr(sizeof(SPECIAL) - 1);
+  }
+  return path;
+}
+
+KodiHost::Counters KodiHost::GetCounters()
+{
+  Counters counters;
+  counters.requests = s_requests;
+  counters.failedRequests = s_failedRequests;
+  counters.epgEvents = s_epgEvents;
+  counters.epgEntries = s_epgEntries;
+  counters.channels = s_channels;
+  counters.recordings = s_recordings;
+  counters.timers = s_timers;
+  return counters;
+}
+
+void KodiHost::ResetCounters()
+{
+  s_requests = 0;
+  s_failedRequests = 0;
+  s_epgEvents = 0;
+  s_epgEntries = 0;
+  s_channels = 0;
+  s_recordings = 0;
+  s_timers = 0;
+  P8PLATFORM::CLockObject lock(s_mutex);
+  s_channelUids.clear();
+}
+
+std::vector<unsigned int> KodiHost::GetChannelUids()
+{
+  P8PLATFORM::CLockObject lock(s_mutex);
+  return s_channelUids;
+}
+
+namespace ADDON
+{
+
+bool CHelper_libXBMC_addon::RegisterMe(void *handle)
+{
+  return true;
+}
+
+void CHelper_libXBMC_addon::Log(const addon_log_t loglevel,
+    const char *format, ...)
+{
+  if (loglevel < s_logLevel)
+  {
+    return;
+  }
+  va_list args;
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
+  fputc('\n', stderr);
+}
+
+bool CHelper_libXBMC_addon::GetSetting(const char *settingName,
+    void *settingValue)
+{
+  return false;
+}
+
+void CHelper_libXBMC_addon::QueueNotification(const queue_msg_t type,
+    const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  fputs("Notification: ", stderr);
+  vfprintf(stderr, format, args);
+  va_end(args);
+  fputc('\n', stderr);
+}
+
+char *CHelper_libXBMC_addon::GetLocalizedString(int dwCode)
+{
+  return strdup(("#" + std::to_string(dwCode)).c_str());
+}
+
+void CHelper_libXBMC_addon::FreeString(char *str)
+{
+  free(str);
+}
+
+void CHelper_libXBMC_addon::FreeStringArray(char **arr, int numElements)
+{
+  if (!arr)
+  {
+    return;
+  }
+  for (int i = 0; i < numElements; i++)
+  {
+    free(arr[i]);
+  }
+  delete[] arr;
+}
+
+void *CHelper_libXBMC_addon::OpenFile(const char *strFileName,
+    unsigned int flags)
+{
+  FILE *file = fopen(KodiHost::TranslatePath(strFileName).c_str(), "rb");
+  if (!file)
+  {
+    return nullptr;
+  }
+  auto *hostFile = new HostFile;
+  hostFile->file = file;
+  return hostFile;
+}
+
+void *CHelper_libXBMC_addon::OpenFileForWrite(const char *strFileName,
+    bool bOverWrite)
+{
+  std::string path = KodiHost::TranslatePath(strFileName);
+  // Like Kodi, an existing file is only truncated when overwriting
+  FILE *file = bOverWrite ? nullptr : fopen(path.c_str(), "r+b");
+  if (!file)
+  {
+    file = fopen(path.c_str(), "w+b");
+  }
+  if (!file)
+  {
+    return nullptr;
+  }
+  auto *hostFile = new HostFile;
+  hostFile->file = file;
+  return hostFile;
+}
+
+ssize_t CHelper_libXBMC_addon::ReadFile(void *file, void *lpBuf,
+    size_t uiBufSize)
+{
+  auto *hostFile = static_cast<HostFile*>(file);
+  if (hostFile->file)
+  {
+    return static_cast<ssize_t>(fread(lpBuf, 1, uiBufSize, hostFile->file));
+  }
+  const std::string &body = hostFile->response.body;
+  size_t count = std::min(uiBufSize, body.length() - hostFile->position);
+  memcpy(lpBuf, body.data() + hostFile->position, count);
+  hostFile->position += count;
+  return static_cast<ssize_t>(count);
+}
+
+bool CHelper_libXBMC_addon::ReadFileString(void *file, char *szLine,
+    int iLineLength)
+{
+  auto *hostFile = static_cast<HostFile*>(file);
+  if (!hostFile->file || !fgets(szLine, iLineLength, hostFile->file))
+  {
+    return false;
+  }
+  size_t length = strlen(szLine);
+  while (length > 0 && (szLine[length - 1] == '\n' || szLine[length - 1] == '\r'))
+  {
+    szLine[--length] = '\0';
+  }
+  return true;
+}
+
+ssize_t CHelper_libXBMC_addon::WriteFile(void *file, const void *lpBuf,
+    size_t uiBufSize)
+{
+  auto *hostFile = static_cast<HostFile*>(file);
+  if (!hostFile->file)
+  {
+    return -1;
+  }
+  return static_cast<ssize_t>(fwrite(lpBuf, 1, uiBufSize, hostFile->file));
+}
+
+int64_t CHelper_libXBMC_addon::SeekFile(void *file, int64_t iFilePosition,
+    int iWhence)
+{
+  auto *hostFile = static_cast<HostFile*>(file);
+  if (!hostFile->file
+      || fseeko(hostFile->file, static_cast<off_t>(iFilePosition), iWhence) != 0)
+  {
+    return -1;
+  }
+  return static_cast<int64_t>(ftello(hostFile->file));
+}
+
+int64_t CHelper_libXBMC_addon::GetFileLength(void *file)
+{
+  auto *hostFile = static_cast<HostFile*>(file);
+  if (!hostFile->file)
+  {
+    return static_cast<int64_t>(hostFile->response.body.length());
+  }
+  struct stat status;
+  if (fstat(fileno(hostFile->file), &status) != 0)
+  {
+    return -1;
+  }
+  return static_cast<int64_t>(status.st_size);
+}
+
+void CHelper_libXBMC_addon::CloseFile(void *file)
+{
+  auto *hostFile = static_cast<HostFile*>(file);
+  if (hostFile->file)
+  {
+    fclose(hostFile->file);
+  }
+  delete hostFile;
+}
+
+bool CHelper_libXBMC_addon::FileExists(const char *strFileName, bool bUseCache)
+{
+  struct stat status;
+  return stat(KodiHost::TranslatePath(strFileName).c_str(), &status) == 0
+      && !S_ISDIR(status.st_mode);
+}
+
+int CHelper_libXBMC_addon::StatFile(const char *strFileName,
+    struct __stat64 *buffer)
+{
+  struct stat status;
+  if (stat(KodiHost::TranslatePath(strFileName).c_str(), &status) != 0)
+  {
+    return -1;
+  }
+  memset(buffer, 0, sizeof(*buffer));
+  buffer->st_size = status.st_size;
+  buffer->st_mtime = status.st_mtime;
+  return 0;
+}
+
+bool CHelper_libXBMC_addon::DeleteFile(const char *strFileName)
+{
+  return unlink(KodiHost::TranslatePath(strFileName).c_str()) == 0;
+}
+
+bool CHelper_libXBMC_addon::CreateDirectory(const char *strPath)
+{
+  std::string path = KodiHost::TranslatePath(strPath);
+  while (path.length() > 1 && path.back() == '/')
+  {
+    path.pop_back();
+  }
+  return MakeDirectories(path);
+}
+
+bool CHelper_libXBMC_addon::DirectoryExists(const char *strPath)
+{
+  struct stat status;
+  return stat(KodiHost::TranslatePath(strPath).c_str(), &status) == 0
+      && S_ISDIR(status.st_mode);
+}
+
+bool CHelper_libXBMC_addon::GetDirectory(const char *strPath,
+    const char *mask, VFSDirEntry **items, unsigned int *num_items)
+{
+  std::string directory = strPath;
+  if (!directory.empty() && directory.back() != '/')
+  {
+    directory += '/';
+  }
+  std::string localDirectory = KodiHost::TranslatePath(directory);
+  DIR *dir = opendir(localDirectory.c_str());
+  if (!dir)
+  {
+    return false;
+  }
+  std::vector<VFSDirEntry> entries;
+  while (struct dirent *dirEntry = readdir(dir))
+  {
+    std::string name = dirEntry->d_name;
+    if (name == "." || name == "..")
+    {
+      continue;
+    }
+    struct stat status;
+    if (stat((localDirectory + name).c_str(), &status) != 0)
+    {
+      continue;
+    }
+    bool folder = S_ISDIR(status.st_mode);
+    if (!folder && !MatchesMask(name, mask ? mask : ""))
+    {
+      continue;
+    }
+    VFSDirEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.label = strdup(name.c_str());
+    entry.path = strdup((directory + name + (folder ? "/" : "")).c_str());
+    entry.folder = folder;
+    entry.size = static_cast<uint64_t>(status.st_size);
+    entries.push_back(entry);
+  }
+  closedir(dir);
+
+  *num_items = static_cast<unsigned int>(entries.size());
+  *items = new VFSDirEntry[entries.size() + 1];
+  std::copy(entries.begin(), entries.end(), *items);
+  return true;
+}
+
+void CHelper_libXBMC_addon::FreeDirectory(VFSDirEntry *items,
+    unsigned int num_items)
+{
+  for (unsigned int i = 0; i < num_items; i++)
+  {
+    free(items[i].label);
+    free(items[i].path);
+  }
+  delete[] items;
+}
+
+void *CHelper_libXBMC_addon::CURLCreate(const char *strURL)
+{
+  auto *hostFile = new HostFile;
+  hostFile->url = strURL;
+  return hostFile;
+}
+
+bool CHelper_libXBMC_addon::CURLAddOption(void *file,
+    XFILE::CURLOptiontype type, const char *name, const char *value)
+{
+  auto *hostFile = static_cast<HostFile*>(file);
+  if (type != XFILE::CURL_OPTION_PROTOCOL)
+  {
+    return true;
+  }
+  if (strcmp(name, "customrequest") == 0)
+  {
+    hostFile->action = value;
+  }
+  else if (strcmp(name, "postdata") == 0)
+  {
+    hostFile->postData = Base64Decode(value);
+  }
+  return true;
+}
+
+bool CHelper_libXBMC_addon::CURLOpen(void *file, unsigned int flags)
+{
+  auto *hostFile = static_cast<HostFile*>(file);
+  KodiHost::Responder responder;
+  {
+    P8PLATFORM::CLockObject lock(s_mutex);
+    responder = s_responder;
+  }
+  s_requests++;
+  if (!responder || !responder(hostFile->action, hostFile->url,
+      hostFile->postData, hostFile->response))
+  {
+    s_failedRequests++;
+    return false;
+  }
+  return true;
+}
+
+char *CHelper_libXBMC_addon::GetFilePropertyValue(void *file,
+    XFILE::FilePropertyTypes type, const char *name)
+{
+  auto *hostFile = static_cast<HostFile*>(file);
+  if (type != XFILE::FILE_PROPERTY_RESPONSE_HEADER
+      || strcasecmp(name, "location") != 0
+      || hostFile->response.location.empty())
+  {
+    return nullptr;
+  }
+  return strdup(hostFile->response.location.c_str());
+}
+
+char **CHelper_libXBMC_addon::GetFilePropertyValues(void *file,
+    XFILE::FilePropertyTypes type, const char *name, int *numValues)
+{
+  auto *hostFile = static_cast<HostFile*>(file);
+  *numValues = 0;
+  if (type != XFILE::FILE_PROPERTY_RESPONSE_HEADER
+      || strcasecmp(name, "set-cookie") != 0)
+  {
+    return nullptr;
+  }
+  const std::vector<std::string> &cookies = hostFile->response.cookies;
+  auto **values = new char*[cookies.size() + 1];
+  for (auto const &cookie : cookies)
+  {
+    values[(*numValues)++] = strdup(cookie.c_str());
+  }
+  return values;
+}
+
+}
+
+bool CHelper_libXBMC_pvr::RegisterMe(void *handle)
+{
+  return true;
+}
+
+void CHelper_libXBMC_pvr::AddMenuHook(PVR_MENUHOOK *hook)
+{
+}
+
+void CHelper_libXBMC_pvr::TransferEpgEntry(const ADDON_HANDLE handle,
+    const EPG_TAG *entry)
+{
+  s_epgEntries++;
+}
+
+void CHelper_libXBMC_pvr::TransferChannelEntry(const ADDON_HANDLE handle,
+    const PVR_CHANNEL *entry)
+{
+  s_channels++;
+  P8PLATFORM::CLockObject lock(s_mutex);
+  s_channelUids.push_back(entry->iUniqueId);
+}
+
+void CHelper_libXBMC_pvr::TransferTimerEntry(const ADDON_HANDLE handle,
+    const PVR_TIMER *entry)
+{
+  s_timers++;
+}
+
+void CHelper_libXBMC_pvr::TransferRecordingEntry(const ADDON_HANDLE handle,
+    const PVR_RECORDING *entry)
+{
+  s_recordings++;
+}
+
+void CHelper_libXBMC_pvr::TransferChannelGroup(const ADDON_HANDLE handle,
+    const PVR_CHANNEL_GROUP *entry)
+{
+}
+
+void CHelper_libXBMC_pvr::TransferChannelGroupMember(
+    const ADDON_HANDLE handle, const PVR_CHANNEL_GROUP_MEMBER *entry)
+{
+}
+
+void CHelper_libXBMC_pvr::TriggerTimerUpdate()
+{
+}
+
+void CHelper_libXBMC_pvr::TriggerRecordingUpdate()
+{
+}
+
+void CHelper_libXBMC_pvr::TriggerChannelUpdate()
+{
+}
+
+void CHelper_libXBMC_pvr::TriggerChannelGroupsUpdate()
+{
+}
+
+void CHelper_libXBMC_pvr::TriggerEpgUpdate(unsigned int iChannelUid)
+{
+}
+
+void CHelper_libXBMC_pvr::EpgEventStateChange(EPG_TAG *tag,
+    EPG_EVENT_STATE newState)
+{
+  s_epgEvents++;
+}
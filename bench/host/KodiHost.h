@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "client.h"
+
+/*!
+ * @brief Runs the add-on code without Kodi
+ *
+ * Provides the XBMC and PVR helpers. special:// paths are mapped below a
+ * local directory, http requests are answered by an in-process responder
+ * and everything the add-on hands over to Kodi is counted.
+ */
+class KodiHost
+{
+public:
+  struct Response
+  {
+    std::string body;
+    std::string location;
+    std::vector<std::string> cookies;
+  };
+  typedef std::function<bool(const std::string& action,
+      const std::string& url, const std::string& postData,
+      Response& response)> Responder;
+
+  struct Counters
+  {
+    uint64_t requests;
+    uint64_t failedRequests;
+    uint64_t epgEvents;
+    uint64_t epgEntries;
+    uint64_t channels;
+    uint64_t recordings;
+    uint64_t timers;
+  };
+
+  /*!
+   * @brief Creates the helpers and maps special:// paths below root
+   * @param addonDir Directory of the add-on resources, e.g. pvr.zattoo
+   */
+  static void Start(const std::string& root, const std::string& addonDir);
+  static void Stop();
+  static void SetResponder(const Responder& responder);
+  static void SetLogLevel(ADDON::addon_log_t level);
+  static std::string TranslatePath(const std::string& path);
+  static Counters GetCounters();
+  static void ResetCounters();
+  static std::vector<unsigned int> GetChannelUids();
+};
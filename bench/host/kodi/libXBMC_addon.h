@@ -0,0 +1,69 @@
+#pragma once
+/*
+ * Stand-in for Kodi's libXBMC_addon.h. Only the part of the helper the add-on
+ * uses is declared, KodiHost.cpp implements it without a running Kodi.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "p8-platform/os.h"
+#include "kodi/IFileTypes.h"
+#include "kodi_vfs_types.h"
+
+namespace ADDON
+{
+typedef enum addon_log
+{
+  LOG_DEBUG,
+  LOG_INFO,
+  LOG_NOTICE,
+  LOG_ERROR
+} addon_log_t;
+
+typedef enum queue_msg
+{
+  QUEUE_INFO,
+  QUEUE_WARNING,
+  QUEUE_ERROR
+} queue_msg_t;
+
+class CHelper_libXBMC_addon
+{
+public:
+  bool RegisterMe(void *handle);
+  void Log(const addon_log_t loglevel, const char *format, ...);
+  bool GetSetting(const char *settingName, void *settingValue);
+  void QueueNotification(const queue_msg_t type, const char *format, ...);
+  char *GetLocalizedString(int dwCode);
+  void FreeString(char *str);
+  void FreeStringArray(char **arr, int numElements);
+  void *OpenFile(const char *strFileName, unsigned int flags);
+  void *OpenFileForWrite(const char *strFileName, bool bOverWrite);
+  ssize_t ReadFile(void *file, void *lpBuf, size_t uiBufSize);
+  bool ReadFileString(void *file, char *szLine, int iLineLength);
+  ssize_t WriteFile(void *file, const void *lpBuf, size_t uiBufSize);
+  int64_t SeekFile(void *file, int64_t iFilePosition, int iWhence);
+  int64_t GetFileLength(void *file);
+  void CloseFile(void *file);
+  bool FileExists(const char *strFileName, bool bUseCache);
+  int StatFile(const char *strFileName, struct __stat64 *buffer);
+  bool DeleteFile(const char *strFileName);
+  bool CreateDirectory(const char *strPath);
+  bool DirectoryExists(const char *strPath);
+  bool GetDirectory(const char *strPath, const char *mask,
+      VFSDirEntry **items, unsigned int *num_items);
+  void FreeDirectory(VFSDirEntry *items, unsigned int num_items);
+  void *CURLCreate(const char *strURL);
+  bool CURLAddOption(void *file, XFILE::CURLOptiontype type,
+      const char *name, const char *value);
+  bool CURLOpen(void *file, unsigned int flags);
+  char *GetFilePropertyValue(void *file, XFILE::FilePropertyTypes type,
+      const char *name);
+  char **GetFilePropertyValues(void *file, XFILE::FilePropertyTypes type,
+      const char *name, int *numValues);
+};
+}
@@ -0,0 +1,30 @@
+#pragma once
+/*
+ * Stand-in for Kodi's libXBMC_pvr.h. KodiHost.cpp implements the callbacks
+ * and counts what the add-on hands over to Kodi.
+ */
+
+#include "kodi/xbmc_pvr_types.h"
+
+class CHelper_libXBMC_pvr
+{
+public:
+  bool RegisterMe(void *handle);
+  void AddMenuHook(PVR_MENUHOOK *hook);
+  void TransferEpgEntry(const ADDON_HANDLE handle, const EPG_TAG *entry);
+  void TransferChannelEntry(const ADDON_HANDLE handle,
+      const PVR_CHANNEL *entry);
+  void TransferTimerEntry(const ADDON_HANDLE handle, const PVR_TIMER *entry);
+  void TransferRecordingEntry(const ADDON_HANDLE handle,
+      const PVR_RECORDING *entry);
+  void TransferChannelGroup(const ADDON_HANDLE handle,
+      const PVR_CHANNEL_GROUP *entry);
+  void TransferChannelGroupMember(const ADDON_HANDLE handle,
+      const PVR_CHANNEL_GROUP_MEMBER *entry);
+  void TriggerTimerUpdate();
+  void TriggerRecordingUpdate();
+  void TriggerChannelUpdate();
+  void TriggerChannelGroupsUpdate();
+  void TriggerEpgUpdate(unsigned int iChannelUid);
+  void EpgEventStateChange(EPG_TAG *tag, EPG_EVENT_STATE newState);
+};
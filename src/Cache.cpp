@@ -1,6 +1,7 @@
 #include "Cache.h"
 #include "client.h"
 #include "Utils.h"
+#include "Trace.h"
 #include "kodi_vfs_types.h"
 #include "rapidjson/writer.h"
 #include "rapidjson/stringbuffer.h"
@@ -20,10 +21,9 @@ using namespace ADDON;
 
 constexpr char CACHE_DIR[] = "special://profile/addon_data/pvr.zattoo/cache/";
 
-time_t Cache::m_lastCleanup = 0;
-
 bool Cache::Read(const std::string& key, std::string& data)
 {
+  TraceSpan span("cache read");
   std::string cacheFile = CACHE_DIR + key;
   if (!XBMC->FileExists(cacheFile.c_str(), true))
   {
@@ -56,6 +56,7 @@ bool Cache::Read(const std::string& key, std::string& data)
 
 void Cache::Write(const std::string& key, const std::string& data, time_t validUntil)
 {
+  TraceSpan span("cache write");
   if (!XBMC->DirectoryExists(CACHE_DIR))
   {
     if (!XBMC->CreateDirectory(CACHE_DIR))
@@ -90,13 +91,6 @@ void Cache::Write(const std::string& key, const std::string& data, time_t validU
 
 void Cache::Cleanup()
 {
-  time_t currTime;
-  time(&currTime);
-  if (m_lastCleanup + 60 * 60 > currTime)
-  {
-   return;
-  }
-  m_lastCleanup = currTime;
   if (!XBMC->DirectoryExists(CACHE_DIR))
   {
     return;
@@ -10,5 +10,4 @@ public:
   static void Cleanup();
 private:
   static bool IsStillValid(const rapidjson::Value& cache);
-  static time_t m_lastCleanup;
 };
@@ -1,9 +1,53 @@
 #include "Curl.h"
+#include <chrono>
+#include <thread>
 #include <utility>
 #include "client.h"
+#include "md5.h"
 #include "Utils.h"
+#include "rapidjson/document.h"
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+
+#ifdef TARGET_WINDOWS
+#include <windows.h>
+#ifdef CreateDirectory
+#undef CreateDirectory
+#endif
+#endif
 
 using namespace ADDON;
+using namespace rapidjson;
+
+constexpr char TRAFFIC_DIR[] =
+    "special://profile/addon_data/pvr.zattoo/traffic/";
+// Values of these parameters are never written to recorded traffic
+const char *scrubbedParameters[] = { "login", "password", "client_app_token",
+    "uuid" };
+// Members of response bodies that hold the account of the user
+const char *scrubbedMembers[] = { "account", "login", "email" };
+constexpr char SCRUBBED[] = "scrubbed";
+
+TrafficMode Curl::m_trafficMode = TRAFFIC_LIVE;
+int Curl::m_replayLatency = 0;
+int Curl::m_replayBandwidth = 0;
+
+void Curl::SetTrafficMode(TrafficMode mode, int latency, int bandwidth)
+{
+  m_trafficMode = mode;
+  m_replayLatency = latency;
+  m_replayBandwidth = bandwidth;
+  if (mode == TRAFFIC_RECORD)
+  {
+    XBMC->Log(LOG_NOTICE, "Recording http traffic to [%s].", TRAFFIC_DIR);
+  }
+  else if (mode == TRAFFIC_REPLAY)
+  {
+    XBMC->Log(LOG_NOTICE,
+        "Replaying http traffic from [%s] with %d ms latency and %d kbit/s.",
+        TRAFFIC_DIR, latency, bandwidth);
+  }
+}
 
 Curl::Curl()
 = default;
@@ -53,6 +97,11 @@ std::string Curl::Post(const std::string& url, const std::string& postData, int
 std::string Curl::Request(const std::string& action, const std::string& url, const std::string& postData,
     int &statusCode)
 {
+  if (m_trafficMode == TRAFFIC_REPLAY)
+  {
+    return Replay(action, url, postData, statusCode);
+  }
+
   void* file = XBMC->CURLCreate(url.c_str());
   if (!file)
   {
@@ -134,6 +183,195 @@ std::string Curl::Request(const std::string& action, const std::string& url, con
 
   XBMC->CloseFile(file);
   statusCode = 200;
+  if (m_trafficMode == TRAFFIC_RECORD)
+  {
+    Record(action, url, postData, body);
+  }
+  return body;
+}
+
+std::string Curl::Scrub(const std::string& parameters)
+{
+  std::string scrubbed = parameters;
+  for (const char *name : scrubbedParameters)
+  {
+    std::string key = std::string(name) + "=";
+    size_t pos = 0;
+    while ((pos = scrubbed.find(key, pos)) != std::string::npos)
+    {
+      bool atStart = pos == 0 || scrubbed[pos - 1] == '&'
+          || scrubbed[pos - 1] == '?';
+      pos += key.length();
+      if (!atStart)
+      {
+        continue;
+      }
+      size_t end = scrubbed.find('&', pos);
+      scrubbed.replace(pos,
+          (end == std::string::npos ? scrubbed.length() : end) - pos, SCRUBBED);
+    }
+  }
+  return scrubbed;
+}
+
+static bool ScrubMembers(Value& value)
+{
+  bool scrubbed = false;
+  if (value.IsObject())
+  {
+    for (Value::MemberIterator itr = value.MemberBegin();
+        itr != value.MemberEnd(); ++itr)
+    {
+      bool secret = false;
+      for (const char *name : scrubbedMembers)
+      {
+        secret = secret || std::string(name) == itr->name.GetString();
+      }
+      if (secret)
+      {
+        itr->value.SetString(SCRUBBED, sizeof(SCRUBBED) - 1);
+        scrubbed = true;
+      }
+      else
+      {
+        scrubbed = ScrubMembers(itr->value) || scrubbed;
+      }
+    }
+  }
+  else if (value.IsArray())
+  {
+    for (Value::ValueIterator itr = value.Begin(); itr != value.End(); ++itr)
+    {
+      scrubbed = ScrubMembers(*itr) || scrubbed;
+    }
+  }
+  return scrubbed;
+}
+
+std::string Curl::ScrubBody(const std::string& body)
+{
+  // The home page hands out the app token
+  std::string key = "window.appToken = '";
+  size_t pos = body.find(key);
+  if (pos != std::string::npos)
+  {
+    std::string scrubbed = body;
+    pos += key.length();
+    size_t end = scrubbed.find('\'', pos);
+    scrubbed.replace(pos,
+        (end == std::string::npos ? scrubbed.length() : end) - pos, SCRUBBED);
+    return scrubbed;
+  }
+
+  Document doc;
+  doc.Parse(body.c_str());
+  if (doc.GetParseError() || !ScrubMembers(doc))
+  {
+    return body;
+  }
+  StringBuffer buffer;
+  Writer<StringBuffer> writer(buffer);
+  doc.Accept(writer);
+  return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+std::string Curl::TrafficFile(const std::string& action,
+    const std::string& url, const std::string& postData)
+{
+  return TRAFFIC_DIR + md5(action + " " + Scrub(url) + "\n" + Scrub(postData))
+      + ".json";
+}
+
+void Curl::Record(const std::string& action, const std::string& url,
+    const std::string& postData, const std::string& body)
+{
+  if (!XBMC->DirectoryExists(TRAFFIC_DIR) && !XBMC->CreateDirectory(TRAFFIC_DIR))
+  {
+    XBMC->Log(LOG_ERROR, "Could not create traffic directory [%s].",
+        TRAFFIC_DIR);
+    return;
+  }
+
+  StringBuffer buffer;
+  Writer<StringBuffer> writer(buffer);
+  writer.StartObject();
+  writer.Key("action");
+  writer.String(action.c_str());
+  writer.Key("url");
+  writer.String(Scrub(url).c_str());
+  writer.Key("postData");
+  writer.String(Scrub(postData).c_str());
+  writer.Key("location");
+  writer.String(m_location.c_str());
+  // Only the names of cookies are kept, their values are session secrets
+  writer.Key("cookies");
+  writer.StartArray();
+  for (auto const &cookie : m_cookies)
+  {
+    writer.String(cookie.first.c_str());
+  }
+  writer.EndArray();
+  writer.Key("body");
+  std::string scrubbedBody = ScrubBody(body);
+  writer.String(scrubbedBody.c_str(),
+      static_cast<SizeType>(scrubbedBody.length()));
+  writer.EndObject();
+
+  std::string file = TrafficFile(action, url, postData);
+  void *handle = XBMC->OpenFileForWrite(file.c_str(), true);
+  if (!handle)
+  {
+    XBMC->Log(LOG_ERROR, "Could not write traffic file [%s].", file.c_str());
+    return;
+  }
+  XBMC->WriteFile(handle, buffer.GetString(), buffer.GetSize());
+  XBMC->CloseFile(handle);
+}
+
+std::string Curl::Replay(const std::string& action, const std::string& url,
+    const std::string& postData, int &statusCode)
+{
+  std::string file = TrafficFile(action, url, postData);
+  Document doc;
+  if (XBMC->FileExists(file.c_str(), true))
+  {
+    doc.Parse(Utils::ReadFile(file).c_str());
+  }
+  if (doc.GetParseError() || !doc.IsObject() || !doc.HasMember("body")
+      || !doc["body"].IsString())
+  {
+    XBMC->Log(LOG_ERROR, "No recorded traffic for %s %s.", action.c_str(),
+        url.c_str());
+    statusCode = 404;
+    return "";
+  }
+
+  std::string body(doc["body"].GetString(), doc["body"].GetStringLength());
+  int64_t delay = m_replayLatency;
+  if (m_replayBandwidth > 0)
+  {
+    delay += static_cast<int64_t>(body.length()) * 8 / m_replayBandwidth;
+  }
+  if (delay > 0)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+  }
+
+  m_location = doc.HasMember("location") && doc["location"].IsString() ?
+      doc["location"].GetString() : "";
+  if (doc.HasMember("cookies") && doc["cookies"].IsArray())
+  {
+    const Value& cookies = doc["cookies"];
+    for (Value::ConstValueIterator itr = cookies.Begin(); itr != cookies.End();
+        ++itr)
+    {
+      if (itr->IsString())
+      {
+        m_cookies[itr->GetString()] = SCRUBBED;
+      }
+    }
+  }
+  statusCode = 200;
   return body;
 }
 
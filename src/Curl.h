@@ -1,9 +1,28 @@
+#pragma once
+
 #include <string>
 #include <map>
 
+enum TrafficMode
+{
+  TRAFFIC_LIVE = 0,
+  TRAFFIC_RECORD,
+  TRAFFIC_REPLAY
+};
+
 class Curl
 {
 public:
+  /*!
+   * @brief Records responses to disk or serves recorded ones instead of the network
+   * @param latency Delay of every replayed response in milliseconds
+   * @param bandwidth Replay speed in kbit/s, 0 for unlimited
+   */
+  static void SetTrafficMode(TrafficMode mode, int latency, int bandwidth);
+  static TrafficMode GetTrafficMode() {
+    return m_trafficMode;
+  }
+
   Curl();
   ~Curl();
   std::string Delete(const std::string& url, int &statusCode);
@@ -21,10 +40,21 @@ public:
 private:
   std::string Request(const std::string& action, const std::string& url,
                               const std::string& postData, int &statusCode);
+  std::string Replay(const std::string& action, const std::string& url,
+      const std::string& postData, int &statusCode);
+  void Record(const std::string& action, const std::string& url,
+      const std::string& postData, const std::string& body);
+  static std::string TrafficFile(const std::string& action,
+      const std::string& url, const std::string& postData);
+  static std::string Scrub(const std::string& parameters);
+  static std::string ScrubBody(const std::string& body);
   std::string Base64Encode(unsigned char const* in, unsigned int in_len,
       bool urlEncode);
   std::map<std::string, std::string> m_headers;
   std::map<std::string, std::string> m_options;
   std::map<std::string, std::string> m_cookies;
   std::string m_location;
+  static TrafficMode m_trafficMode;
+  static int m_replayLatency;
+  static int m_replayBandwidth;
 };
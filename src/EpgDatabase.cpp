@@ -0,0 +1,290 @@
+#include "EpgDatabase.h"
+#include "client.h"
+#include "kodi_vfs_types.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#ifdef TARGET_ANDROID
+#include "to_string.h"
+#endif
+
+#ifdef TARGET_WINDOWS
+#include <windows.h>
+#ifdef CreateDirectory
+#undef CreateDirectory
+#endif
+#ifdef DeleteFile
+#undef DeleteFile
+#endif
+#endif
+
+using namespace ADDON;
+
+constexpr char EPG_DIR[] = "special://profile/addon_data/pvr.zattoo/epg/";
+constexpr char EPG_MAGIC[] = "ZEPG";
+const uint32_t EPG_VERSION = 2;
+const time_t partitionDuration = 86400;
+
+struct EpgFileHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t recordCount;
+  uint32_t stringsSize;
+};
+
+struct EpgFileRecord
+{
+  int64_t startTime;
+  int64_t endTime;
+  int32_t broadcastId;
+  uint32_t titleOffset;
+  uint32_t plotOffset;
+  uint32_t iconPathOffset;
+  uint32_t genreOffset;
+  int32_t genre;
+};
+
+time_t EpgDatabase::PartitionStart(time_t time)
+{
+  return time - (time % partitionDuration);
+}
+
+std::string EpgDatabase::PartitionFile(const std::string& cid, time_t day)
+{
+  return EPG_DIR + cid + "-" + std::to_string(static_cast<int64_t>(day))
+      + ".bin";
+}
+
+bool EpgDatabase::Load(const std::string& cid, int uniqueChannelId,
+    time_t start, time_t end, EpgStore& store)
+{
+  bool loaded = false;
+  for (time_t day = PartitionStart(start); day < end; day += partitionDuration)
+  {
+    std::string file = PartitionFile(cid, day);
+    if (!XBMC->FileExists(file.c_str(), true))
+    {
+      continue;
+    }
+    loaded |= LoadPartition(file, uniqueChannelId, store);
+  }
+  return loaded;
+}
+
+bool EpgDatabase::LoadPartition(const std::string& file, int uniqueChannelId,
+    EpgStore& store)
+{
+  void *handle = XBMC->OpenFile(file.c_str(), 0);
+  if (!handle)
+  {
+    return false;
+  }
+  int64_t length = XBMC->GetFileLength(handle);
+  std::vector<char> buffer;
+  if (length >= static_cast<int64_t>(sizeof(EpgFileHeader)))
+  {
+    buffer.resize(static_cast<size_t>(length));
+    ssize_t read = XBMC->ReadFile(handle, buffer.data(), buffer.size());
+    if (read != static_cast<ssize_t>(length))
+    {
+      buffer.clear();
+    }
+  }
+  XBMC->CloseFile(handle);
+
+  if (buffer.empty())
+  {
+    XBMC->Log(LOG_ERROR, "Could not read epg database file [%s].",
+        file.c_str());
+    return false;
+  }
+
+  const auto *header = reinterpret_cast<const EpgFileHeader*>(buffer.data());
+  // Check the counts against the file size before multiplying them
+  size_t available = buffer.size() - sizeof(EpgFileHeader);
+  if (memcmp(header->magic, EPG_MAGIC, sizeof(header->magic))
+      || header->version != EPG_VERSION
+      || header->recordCount > available / sizeof(EpgFileRecord)
+      || header->stringsSize
+          != available - header->recordCount * sizeof(EpgFileRecord))
+  {
+    XBMC->Log(LOG_ERROR, "Ignoring invalid epg database file [%s].",
+        file.c_str());
+    return false;
+  }
+
+  size_t recordsSize = header->recordCount * sizeof(EpgFileRecord);
+  const auto *records = reinterpret_cast<const EpgFileRecord*>(buffer.data()
+      + sizeof(EpgFileHeader));
+  const char *strings = buffer.data() + sizeof(EpgFileHeader) + recordsSize;
+  if (header->stringsSize == 0 || strings[header->stringsSize - 1] != '\0')
+  {
+    XBMC->Log(LOG_ERROR, "Ignoring invalid epg database file [%s].",
+        file.c_str());
+    return false;
+  }
+
+  std::shared_ptr<StringPool> pool = store.GetStrings();
+  std::map<uint32_t, unsigned int> idsByOffset;
+  auto intern = [&](uint32_t offset) -> unsigned int
+  {
+    if (offset >= header->stringsSize)
+    {
+      return 0;
+    }
+    auto it = idsByOffset.find(offset);
+    if (it != idsByOffset.end())
+    {
+      return it->second;
+    }
+    unsigned int id = pool->Intern(std::string(strings + offset));
+    idsByOffset[offset] = id;
+    return id;
+  };
+
+  std::vector<PVRIptvEpgEntry> entries;
+  entries.reserve(header->recordCount);
+  for (uint32_t i = 0; i < header->recordCount; i++)
+  {
+    const EpgFileRecord &record = records[i];
+    PVRIptvEpgEntry entry;
+    entry.iBroadcastId = record.broadcastId;
+    entry.iChannelId = uniqueChannelId;
+    entry.startTime = static_cast<time_t>(record.startTime);
+    entry.endTime = static_cast<time_t>(record.endTime);
+    entry.titleId = intern(record.titleOffset);
+    entry.plotId = intern(record.plotOffset);
+    entry.iconPathId = intern(record.iconPathOffset);
+    entry.genreId = intern(record.genreOffset);
+    entry.genre = record.genre;
+    entries.push_back(entry);
+  }
+  store.Merge(uniqueChannelId, entries, pool, false);
+  return true;
+}
+
+bool EpgDatabase::Save(const std::string& cid, int uniqueChannelId, time_t day,
+    EpgStore& store)
+{
+  std::vector<PVRIptvEpgEntry> entries;
+  std::shared_ptr<StringPool> pool = store.CopyRange(uniqueChannelId,
+      day, day + partitionDuration, entries);
+  entries.erase(std::remove_if(entries.begin(), entries.end(),
+      [day](const PVRIptvEpgEntry &entry) { return entry.startTime < day; }),
+      entries.end());
+  if (entries.empty())
+  {
+    // Otherwise the next start would restore the dropped programs
+    std::string file = PartitionFile(cid, day);
+    if (XBMC->FileExists(file.c_str(), false) && !XBMC->DeleteFile(file.c_str()))
+    {
+      XBMC->Log(LOG_ERROR, "Could not delete epg database file [%s].",
+          file.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  // Strings are stored once per file, offset 0 is the empty string
+  std::string strings(1, '\0');
+  std::map<unsigned int, uint32_t> offsetsById;
+  offsetsById[0] = 0;
+  auto offset = [&](unsigned int id) -> uint32_t
+  {
+    auto it = offsetsById.find(id);
+    if (it != offsetsById.end())
+    {
+      return it->second;
+    }
+    auto stringOffset = static_cast<uint32_t>(strings.size());
+    const std::string &str = pool->Get(id);
+    strings.append(str.c_str(), str.length() + 1);
+    offsetsById[id] = stringOffset;
+    return stringOffset;
+  };
+
+  std::vector<EpgFileRecord> records;
+  records.reserve(entries.size());
+  for (auto const &entry : entries)
+  {
+    EpgFileRecord record{};
+    record.startTime = static_cast<int64_t>(entry.startTime);
+    record.endTime = static_cast<int64_t>(entry.endTime);
+    record.broadcastId = entry.iBroadcastId;
+    record.titleOffset = offset(entry.titleId);
+    record.plotOffset = offset(entry.plotId);
+    record.iconPathOffset = offset(entry.iconPathId);
+    record.genreOffset = offset(entry.genreId);
+    record.genre = entry.genre;
+    records.push_back(record);
+  }
+
+  EpgFileHeader header{};
+  memcpy(header.magic, EPG_MAGIC, sizeof(header.magic));
+  header.version = EPG_VERSION;
+  header.recordCount = static_cast<uint32_t>(records.size());
+  header.stringsSize = static_cast<uint32_t>(strings.size());
+
+  if (!XBMC->DirectoryExists(EPG_DIR) && !XBMC->CreateDirectory(EPG_DIR))
+  {
+    XBMC->Log(LOG_ERROR, "Could not create epg database directory [%s].",
+        EPG_DIR);
+    return false;
+  }
+  std::string file = PartitionFile(cid, day);
+  void *handle = XBMC->OpenFileForWrite(file.c_str(), true);
+  if (!handle)
+  {
+    XBMC->Log(LOG_ERROR, "Could not write epg database file [%s].",
+        file.c_str());
+    return false;
+  }
+  XBMC->WriteFile(handle, &header, sizeof(header));
+  XBMC->WriteFile(handle, records.data(),
+      records.size() * sizeof(EpgFileRecord));
+  XBMC->WriteFile(handle, strings.data(), strings.size());
+  XBMC->CloseFile(handle);
+  return true;
+}
+
+void EpgDatabase::Cleanup(time_t before)
+{
+  if (!XBMC->DirectoryExists(EPG_DIR))
+  {
+    return;
+  }
+  VFSDirEntry *items;
+  unsigned int itemCount;
+  if (!XBMC->GetDirectory(EPG_DIR, ".bin", &items, &itemCount))
+  {
+    XBMC->Log(LOG_ERROR, "Could not get epg database directory.");
+    return;
+  }
+  for (unsigned int i = 0; i < itemCount; i++)
+  {
+    if (items[i].folder)
+    {
+      continue;
+    }
+    std::string name = items[i].label;
+    size_t separator = name.rfind('-');
+    if (separator == std::string::npos)
+    {
+      continue;
+    }
+    auto day = static_cast<time_t>(strtoll(name.c_str() + separator + 1,
+        nullptr, 10));
+    if (day + partitionDuration < before)
+    {
+      XBMC->Log(LOG_DEBUG, "Deleting outdated epg database file [%s].",
+          items[i].path);
+      XBMC->DeleteFile(items[i].path);
+    }
+  }
+  XBMC->FreeDirectory(items, itemCount);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <ctime>
+#include <string>
+#include "EpgStore.h"
+
+/*!
+ * @brief Binary on-disk copy of the guide, one file per channel and day
+ *
+ * A partition file consists of a header, fixed size program records and a
+ * block of zero terminated strings the records point into by offset, so it
+ * can be used directly once read (or mapped) into memory.
+ */
+class EpgDatabase
+{
+public:
+  static bool Load(const std::string& cid, int uniqueChannelId, time_t start,
+      time_t end, EpgStore& store);
+  static bool Save(const std::string& cid, int uniqueChannelId, time_t day,
+      EpgStore& store);
+  static void Cleanup(time_t before);
+  static time_t PartitionStart(time_t time);
+
+private:
+  static std::string PartitionFile(const std::string& cid, time_t day);
+  static bool LoadPartition(const std::string& file, int uniqueChannelId,
+      EpgStore& store);
+};
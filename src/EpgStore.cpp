@@ -0,0 +1,384 @@
+#include "EpgStore.h"
+#include "EpgDatabase.h"
+#include <algorithm>
+
+static bool StartsBefore(const PVRIptvEpgEntry& entry, time_t time)
+{
+  return entry.startTime < time;
+}
+
+static bool StartsAfter(time_t time, const PVRIptvEpgEntry& entry)
+{
+  return time < entry.startTime;
+}
+
+static bool EndsBefore(const PVRIptvEpgEntry& entry, time_t time)
+{
+  return entry.endTime <= time;
+}
+
+static bool SameProgram(const PVRIptvEpgEntry& a, const PVRIptvEpgEntry& b)
+{
+  return a.startTime == b.startTime && a.endTime == b.endTime
+      && a.iBroadcastId == b.iBroadcastId && a.titleId == b.titleId
+      && a.plotId == b.plotId && a.iconPathId == b.iconPathId
+      && a.genreId == b.genreId && a.genre == b.genre;
+}
+
+bool ChannelEpg::Merge(std::vector<PVRIptvEpgEntry>& entries,
+    std::vector<time_t> *replaced)
+{
+  if (entries.empty())
+  {
+    return false;
+  }
+  std::stable_sort(entries.begin(), entries.end(),
+      [](const PVRIptvEpgEntry& a, const PVRIptvEpgEntry& b)
+      { return a.startTime < b.startTime; });
+
+  // A later entry with the same start time replaces the earlier one
+  auto last = std::unique(entries.rbegin(), entries.rend(),
+      [](const PVRIptvEpgEntry& a, const PVRIptvEpgEntry& b)
+      { return a.startTime == b.startTime; });
+  entries.erase(entries.begin(), last.base());
+
+  // Replace everything starting within the new window
+  auto first = std::lower_bound(m_entries.begin(), m_entries.end(),
+      entries.front().startTime, StartsBefore);
+  auto end = std::upper_bound(first, m_entries.end(),
+      entries.back().startTime, StartsAfter);
+  // Collect the start times of programs which are new, gone or different
+  bool changed = false;
+  auto oldIt = first;
+  auto newIt = entries.begin();
+  while (oldIt != end || newIt != entries.end())
+  {
+    time_t startTime;
+    if (newIt == entries.end()
+        || (oldIt != end && oldIt->startTime < newIt->startTime))
+    {
+      startTime = (oldIt++)->startTime;
+    }
+    else if (oldIt == end || newIt->startTime < oldIt->startTime)
+    {
+      startTime = (newIt++)->startTime;
+    }
+    else if (!SameProgram(*oldIt++, *newIt++))
+    {
+      startTime = oldIt[-1].startTime;
+    }
+    else
+    {
+      continue;
+    }
+    changed = true;
+    if (replaced)
+    {
+      replaced->push_back(startTime);
+    }
+  }
+  if (!changed)
+  {
+    return false;
+  }
+
+  size_t replacedCount = static_cast<size_t>(end - first);
+  size_t common = std::min(replacedCount, entries.size());
+  std::move(entries.begin(), entries.begin() + common, first);
+  if (common < replacedCount)
+  {
+    m_entries.erase(first + common, end);
+  }
+  else
+  {
+    m_entries.insert(first + common,
+        std::make_move_iterator(entries.begin() + common),
+        std::make_move_iterator(entries.end()));
+  }
+  return true;
+}
+
+void ChannelEpg::RemoveEndedBefore(time_t time)
+{
+  m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(),
+      [time](const PVRIptvEpgEntry& entry) { return entry.endTime < time; }),
+      m_entries.end());
+}
+
+std::pair<ChannelEpg::const_iterator, ChannelEpg::const_iterator> ChannelEpg::GetRange(
+    time_t start, time_t end) const
+{
+  auto first = std::lower_bound(m_entries.begin(), m_entries.end(), start,
+      EndsBefore);
+  auto last = std::lower_bound(first, m_entries.end(), end, StartsBefore);
+  return std::make_pair(first, last);
+}
+
+EpgStore::EpgStore() :
+    m_strings(std::make_shared<StringPool>())
+{
+}
+
+std::shared_ptr<StringPool> EpgStore::GetStrings()
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  return m_strings;
+}
+
+void EpgStore::Merge(int uniqueChannelId, std::vector<PVRIptvEpgEntry>& entries,
+    const std::shared_ptr<StringPool>& strings, bool markDirty)
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  if (strings != m_strings)
+  {
+    // The store was pruned since the texts were interned
+    for (auto &entry : entries)
+    {
+      entry.titleId = m_strings->Intern(strings->Get(entry.titleId));
+      entry.plotId = m_strings->Intern(strings->Get(entry.plotId));
+      entry.iconPathId = m_strings->Intern(strings->Get(entry.iconPathId));
+      entry.genreId = m_strings->Intern(strings->Get(entry.genreId));
+    }
+  }
+  if (markDirty)
+  {
+    time(&m_channelUpdates[uniqueChannelId]);
+  }
+  // Only partitions whose programs changed need to be written again
+  std::vector<time_t> replaced;
+  if (!m_channels[uniqueChannelId].Merge(entries, &replaced) || !markDirty)
+  {
+    return;
+  }
+  for (time_t startTime : replaced)
+  {
+    m_dirtyPartitions.insert(std::make_pair(uniqueChannelId,
+        EpgDatabase::PartitionStart(startTime)));
+  }
+}
+
+std::shared_ptr<StringPool> EpgStore::CopyRange(int uniqueChannelId,
+    time_t start, time_t end, std::vector<PVRIptvEpgEntry>& entries)
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  auto channel = m_channels.find(uniqueChannelId);
+  if (channel != m_channels.end())
+  {
+    std::pair<ChannelEpg::const_iterator, ChannelEpg::const_iterator> range =
+        channel->second.GetRange(start, end);
+    entries.insert(entries.end(), range.first, range.second);
+  }
+  return m_strings;
+}
+
+size_t EpgStore::Prune(time_t endedBefore)
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  size_t pruned = 0;
+  // Readers keep the old pool alive as long as they refer to it
+  auto strings = std::make_shared<StringPool>();
+  std::vector<unsigned int> ids(m_strings->Size(), 0);
+  auto remap = [&](unsigned int &id)
+  {
+    if (id && !ids[id])
+    {
+      ids[id] = strings->Intern(m_strings->Get(id));
+    }
+    id = ids[id];
+  };
+  for (auto it = m_channels.begin(); it != m_channels.end();)
+  {
+    size_t size = it->second.Size();
+    it->second.RemoveEndedBefore(endedBefore);
+    pruned += size - it->second.Size();
+    if (it->second.Empty())
+    {
+      it = m_channels.erase(it);
+      continue;
+    }
+    it->second.Update([&](PVRIptvEpgEntry &entry)
+    {
+      remap(entry.titleId);
+      remap(entry.plotId);
+      remap(entry.iconPathId);
+      remap(entry.genreId);
+    });
+    ++it;
+  }
+  m_strings = strings;
+
+  // Channels without programs are restored and loaded again when requested
+  for (auto it = m_channelUpdates.begin(); it != m_channelUpdates.end();)
+  {
+    if (m_channels.count(it->first))
+    {
+      ++it;
+    }
+    else
+    {
+      it = m_channelUpdates.erase(it);
+    }
+  }
+  for (auto it = m_restoredChannels.begin(); it != m_restoredChannels.end();)
+  {
+    if (m_channels.count(*it))
+    {
+      ++it;
+    }
+    else
+    {
+      it = m_restoredChannels.erase(it);
+    }
+  }
+
+  time_t currentTime;
+  time(&currentTime);
+  for (auto it = m_loadedWindows.begin(); it != m_loadedWindows.end();)
+  {
+    if (it->second < currentTime)
+    {
+      it = m_loadedWindows.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+  return pruned;
+}
+
+size_t EpgStore::Size()
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  size_t size = 0;
+  for (auto const &channel : m_channels)
+  {
+    size += channel.second.Size();
+  }
+  return size;
+}
+
+std::set<std::pair<int, time_t>> EpgStore::TakeDirtyPartitions()
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  std::set<std::pair<int, time_t>> dirtyPartitions;
+  dirtyPartitions.swap(m_dirtyPartitions);
+  return dirtyPartitions;
+}
+
+bool EpgStore::MarkRestored(int uniqueChannelId)
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  return m_restoredChannels.insert(uniqueChannelId).second;
+}
+
+void EpgStore::RetainChannels(const std::set<int>& uniqueChannelIds)
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  for (auto it = m_channels.begin(); it != m_channels.end();)
+  {
+    if (uniqueChannelIds.count(it->first))
+    {
+      ++it;
+    }
+    else
+    {
+      it = m_channels.erase(it);
+    }
+  }
+  for (auto it = m_channelUpdates.begin(); it != m_channelUpdates.end();)
+  {
+    if (uniqueChannelIds.count(it->first))
+    {
+      ++it;
+    }
+    else
+    {
+      it = m_channelUpdates.erase(it);
+    }
+  }
+  for (auto it = m_restoredChannels.begin(); it != m_restoredChannels.end();)
+  {
+    if (uniqueChannelIds.count(*it))
+    {
+      ++it;
+    }
+    else
+    {
+      it = m_restoredChannels.erase(it);
+    }
+  }
+}
+
+bool EpgStore::IsChannelOutdated(int uniqueChannelId, time_t updatedBefore)
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  auto it = m_channelUpdates.find(uniqueChannelId);
+  return it == m_channelUpdates.end() || it->second < updatedBefore;
+}
+
+bool EpgStore::IsWindowLoaded(time_t windowStart)
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  auto it = m_loadedWindows.find(windowStart);
+  if (it == m_loadedWindows.end())
+  {
+    return false;
+  }
+  time_t currentTime;
+  time(&currentTime);
+  return it->second >= currentTime;
+}
+
+void EpgStore::SetWindowLoaded(time_t windowStart, time_t validUntil)
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  m_loadedWindows[windowStart] = validUntil;
+}
+
+std::vector<const PVRIptvEpgEntry*> EpgStore::MergeSources(
+    const std::vector<PVRIptvEpgEntry>& preferred,
+    const std::vector<PVRIptvEpgEntry>& other)
+{
+  std::vector<const PVRIptvEpgEntry*> merged;
+  merged.reserve(preferred.size() + other.size());
+  auto next = preferred.begin();
+  for (auto const &entry : other)
+  {
+    // Take all preferred programs starting before this one
+    auto first = std::lower_bound(next, preferred.end(), entry.startTime,
+        EndsBefore);
+    for (; next != first; ++next)
+    {
+      merged.push_back(&*next);
+    }
+    if (first == preferred.end() || first->startTime >= entry.endTime)
+    {
+      merged.push_back(&entry);
+    }
+  }
+  for (; next != preferred.end(); ++next)
+  {
+    merged.push_back(&*next);
+  }
+  std::stable_sort(merged.begin(), merged.end(),
+      [](const PVRIptvEpgEntry* a, const PVRIptvEpgEntry* b)
+      { return a->startTime < b->startTime; });
+  return merged;
+}
+
+bool EpgStore::Covers(const std::vector<PVRIptvEpgEntry>& entries,
+    time_t start, time_t end)
+{
+  auto it = std::lower_bound(entries.begin(), entries.end(), start,
+      EndsBefore);
+  for (; it != entries.end() && start < end; ++it)
+  {
+    if (it->startTime > start)
+    {
+      return false;
+    }
+    start = std::max(start, it->endTime);
+  }
+  return start >= end;
+}
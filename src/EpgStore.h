@@ -0,0 +1,133 @@
+#pragma once
+
+#include <p8-platform/threads/mutex.h>
+#include "StringPool.h"
+#include <ctime>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct PVRIptvEpgEntry
+{
+  int iBroadcastId;
+  int iChannelId;
+  time_t startTime;
+  time_t endTime;
+  unsigned int titleId;
+  unsigned int plotId;
+  unsigned int iconPathId;
+  unsigned int genreId;
+  int genre;
+};
+
+/*!
+ * @brief Programs of one channel, sorted by start time and stored contiguously
+ */
+class ChannelEpg
+{
+public:
+  typedef std::vector<PVRIptvEpgEntry>::const_iterator const_iterator;
+
+  /*!
+   * @brief Replaces the programs within the time span of entries
+   * @param replaced Receives the start times of added, removed or changed
+   * programs
+   * @return Whether any program was added, removed or changed
+   */
+  bool Merge(std::vector<PVRIptvEpgEntry>& entries,
+      std::vector<time_t> *replaced = nullptr);
+  std::pair<const_iterator, const_iterator> GetRange(time_t start,
+      time_t end) const;
+  bool Empty() const
+  {
+    return m_entries.empty();
+  }
+  size_t Size() const
+  {
+    return m_entries.size();
+  }
+  void RemoveEndedBefore(time_t time);
+
+  /*!
+   * @brief Calls callback with every program, which may modify it
+   */
+  template<typename Callback>
+  void Update(Callback callback)
+  {
+    for (auto &entry : m_entries)
+    {
+      callback(entry);
+    }
+  }
+
+private:
+  std::vector<PVRIptvEpgEntry> m_entries;
+};
+
+class EpgStore
+{
+public:
+  EpgStore();
+
+  /*!
+   * @brief Pool to intern the texts of new programs into before merging them
+   *
+   * The pool is replaced when the store is pruned. Programs interned into a
+   * replaced pool are interned again by Merge.
+   */
+  std::shared_ptr<StringPool> GetStrings();
+  void Merge(int uniqueChannelId, std::vector<PVRIptvEpgEntry>& entries,
+      const std::shared_ptr<StringPool>& strings, bool markDirty = true);
+
+  /*!
+   * @brief Copies the programs of the channel overlapping [start, end)
+   * @return The pool the texts of the copied programs refer to
+   */
+  std::shared_ptr<StringPool> CopyRange(int uniqueChannelId,
+      time_t start, time_t end, std::vector<PVRIptvEpgEntry>& entries);
+
+  /*!
+   * @brief Drops programs which ended before endedBefore and the texts only
+   * they referred to
+   * @return The number of dropped programs
+   */
+  size_t Prune(time_t endedBefore);
+  size_t Size();
+  std::set<std::pair<int, time_t>> TakeDirtyPartitions();
+  bool MarkRestored(int uniqueChannelId);
+  /*!
+   * @brief Drops the programs and the state of all other channels
+   */
+  void RetainChannels(const std::set<int>& uniqueChannelIds);
+  bool IsChannelOutdated(int uniqueChannelId, time_t updatedBefore);
+  bool IsWindowLoaded(time_t windowStart);
+  void SetWindowLoaded(time_t windowStart, time_t validUntil);
+
+  /*!
+   * @brief Combines the sorted programs of two sources
+   *
+   * All preferred programs are kept, programs of the other source only fill
+   * the time slots not covered by a preferred program. The result points
+   * into both vectors, so their texts can be read from their own pools.
+   */
+  static std::vector<const PVRIptvEpgEntry*> MergeSources(
+      const std::vector<PVRIptvEpgEntry>& preferred,
+      const std::vector<PVRIptvEpgEntry>& other);
+  /*!
+   * @brief Checks whether the sorted programs cover [start, end) without gaps
+   */
+  static bool Covers(const std::vector<PVRIptvEpgEntry>& entries,
+      time_t start, time_t end);
+
+private:
+  std::map<int, ChannelEpg> m_channels;
+  std::map<time_t, time_t> m_loadedWindows;
+  std::set<std::pair<int, time_t>> m_dirtyPartitions;
+  std::set<int> m_restoredChannels;
+  std::map<int, time_t> m_channelUpdates;
+  std::shared_ptr<StringPool> m_strings;
+  P8PLATFORM::CMutex m_mutex;
+};
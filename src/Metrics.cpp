@@ -0,0 +1,161 @@
+#include "Metrics.h"
+#include "client.h"
+#include <cctype>
+#include <cstdio>
+
+using namespace ADDON;
+
+constexpr char STATS_FILE[] =
+    "special://profile/addon_data/pvr.zattoo/stats.txt";
+// Upper bounds of the latency buckets, the last one is open
+const int64_t bucketLimits[] = { 50, 100, 250, 500, 1000, 2500, 5000 };
+
+std::map<std::string, Metrics::Stats> Metrics::m_stats;
+uint64_t Metrics::m_cacheHits = 0;
+uint64_t Metrics::m_cacheMisses = 0;
+P8PLATFORM::CMutex Metrics::m_mutex;
+
+void Metrics::AddRequest(const std::string& url, size_t bytes,
+    int64_t durationMs, bool failed)
+{
+  std::string endpoint = Endpoint(url);
+  P8PLATFORM::CLockObject lock(m_mutex);
+  Stats &stats = m_stats[endpoint];
+  Add(stats, durationMs);
+  stats.bytes += bytes;
+  if (failed)
+  {
+    stats.failures++;
+  }
+}
+
+void Metrics::AddDuration(const std::string& name, int64_t durationMs)
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  Add(m_stats[name], durationMs);
+}
+
+void Metrics::AddCacheLookup(bool hit)
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  if (hit)
+  {
+    m_cacheHits++;
+  }
+  else
+  {
+    m_cacheMisses++;
+  }
+}
+
+void Metrics::Add(Stats& stats, int64_t durationMs)
+{
+  stats.count++;
+  stats.totalMs += durationMs;
+  if (durationMs > stats.maxMs)
+  {
+    stats.maxMs = durationMs;
+  }
+  int bucket = 0;
+  while (bucket < bucketCount - 1 && durationMs >= bucketLimits[bucket])
+  {
+    bucket++;
+  }
+  stats.buckets[bucket]++;
+}
+
+/*!
+ * Groups requests by host and path. Query strings are dropped and path
+ * segments containing digits (ids, hashes, times) are replaced by '*'.
+ */
+std::string Metrics::Endpoint(const std::string& url)
+{
+  size_t start = url.find("://");
+  start = start == std::string::npos ? 0 : start + 3;
+  size_t end = url.find('?', start);
+  if (end == std::string::npos)
+  {
+    end = url.size();
+  }
+  std::string endpoint;
+  endpoint.reserve(end - start);
+  size_t segmentStart = start;
+  while (segmentStart < end)
+  {
+    size_t segmentEnd = url.find('/', segmentStart);
+    if (segmentEnd == std::string::npos || segmentEnd > end)
+    {
+      segmentEnd = end;
+    }
+    bool hasDigit = false;
+    for (size_t i = segmentStart; i < segmentEnd && !hasDigit; i++)
+    {
+      hasDigit = isdigit(static_cast<unsigned char>(url[i])) != 0;
+    }
+    if (segmentStart != start)
+    {
+      endpoint += '/';
+    }
+    // Keep short versioned segments like "v2"
+    if (hasDigit && segmentStart != start && segmentEnd - segmentStart > 2)
+    {
+      endpoint += '*';
+    }
+    else
+    {
+      endpoint.append(url, segmentStart, segmentEnd - segmentStart);
+    }
+    segmentStart = segmentEnd + 1;
+  }
+  return endpoint;
+}
+
+std::string Metrics::Summary()
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  std::string summary;
+  char line[512];
+  uint64_t lookups = m_cacheHits + m_cacheMisses;
+  snprintf(line, sizeof(line), "cache: %llu hits, %llu misses (%.1f%% hits)\n",
+      static_cast<unsigned long long>(m_cacheHits),
+      static_cast<unsigned long long>(m_cacheMisses),
+      lookups ? 100.0 * m_cacheHits / lookups : 0.0);
+  summary += line;
+  for (auto const &item : m_stats)
+  {
+    const Stats &stats = item.second;
+    snprintf(line, sizeof(line),
+        "%s: %llu calls, %llu failed, %llu bytes, avg %lld ms, max %lld ms, "
+        "<50/<100/<250/<500/<1000/<2500/<5000/>=5000 ms: "
+        "%llu/%llu/%llu/%llu/%llu/%llu/%llu/%llu\n",
+        item.first.c_str(), static_cast<unsigned long long>(stats.count),
+        static_cast<unsigned long long>(stats.failures),
+        static_cast<unsigned long long>(stats.bytes),
+        static_cast<long long>(stats.totalMs / static_cast<int64_t>(stats.count)),
+        static_cast<long long>(stats.maxMs),
+        static_cast<unsigned long long>(stats.buckets[0]),
+        static_cast<unsigned long long>(stats.buckets[1]),
+        static_cast<unsigned long long>(stats.buckets[2]),
+        static_cast<unsigned long long>(stats.buckets[3]),
+        static_cast<unsigned long long>(stats.buckets[4]),
+        static_cast<unsigned long long>(stats.buckets[5]),
+        static_cast<unsigned long long>(stats.buckets[6]),
+        static_cast<unsigned long long>(stats.buckets[7]));
+    summary += line;
+  }
+  return summary;
+}
+
+void Metrics::Dump()
+{
+  std::string summary = Summary();
+  XBMC->Log(LOG_DEBUG, "Statistics:\n%s", summary.c_str());
+  void *file = XBMC->OpenFileForWrite(STATS_FILE, true);
+  if (!file)
+  {
+    XBMC->Log(LOG_ERROR, "Could not write statistics to [%s].", STATS_FILE);
+    return;
+  }
+  XBMC->WriteFile(file, summary.c_str(), summary.length());
+  XBMC->CloseFile(file);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <p8-platform/threads/mutex.h>
+
+/*!
+ * @brief Counters and latency histograms of requests, cache and epg work
+ */
+class Metrics
+{
+public:
+  static void AddRequest(const std::string& url, size_t bytes,
+      int64_t durationMs, bool failed);
+  static void AddDuration(const std::string& name, int64_t durationMs);
+  static void AddCacheLookup(bool hit);
+  static std::string Summary();
+  static void Dump();
+
+private:
+  static const int bucketCount = 8;
+  struct Stats
+  {
+    uint64_t count;
+    uint64_t failures;
+    uint64_t bytes;
+    int64_t totalMs;
+    int64_t maxMs;
+    uint64_t buckets[bucketCount];
+  };
+
+  static std::string Endpoint(const std::string& url);
+  static void Add(Stats& stats, int64_t durationMs);
+
+  static std::map<std::string, Stats> m_stats;
+  static uint64_t m_cacheHits;
+  static uint64_t m_cacheMisses;
+  static P8PLATFORM::CMutex m_mutex;
+};
@@ -0,0 +1,121 @@
+#include "Scheduler.h"
+#include "client.h"
+
+using namespace ADDON;
+
+const uint32_t maximumWaitMs = 60 * 1000;
+
+Scheduler::Scheduler() :
+    CThread()
+{
+  CreateThread(false);
+}
+
+Scheduler::~Scheduler()
+{
+  StopThread();
+}
+
+bool Scheduler::StopThread(int iWaitMs)
+{
+  CThread::StopThread(-1);
+  m_wakeup.Signal();
+  return CThread::StopThread(iWaitMs);
+}
+
+void Scheduler::AddTask(const std::string& name,
+    const std::function<void()>& task, time_t runAt, time_t interval)
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  ScheduledTask &scheduledTask = m_tasks[name];
+  scheduledTask.task = task;
+  scheduledTask.nextRun = runAt;
+  scheduledTask.interval = interval;
+  Enqueue(name, scheduledTask);
+  m_wakeup.Signal();
+}
+
+void Scheduler::RunNoLaterThan(const std::string& name, time_t runAt)
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  auto it = m_tasks.find(name);
+  if (it == m_tasks.end() || it->second.nextRun <= runAt)
+  {
+    return;
+  }
+  it->second.nextRun = runAt;
+  Enqueue(name, it->second);
+  m_wakeup.Signal();
+}
+
+void Scheduler::RemoveTask(const std::string& name)
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  m_tasks.erase(name);
+}
+
+void Scheduler::Enqueue(const std::string& name, ScheduledTask& task)
+{
+  // Older timer entries of this task become stale and are skipped
+  task.generation = ++m_generation;
+  TimerEntry entry;
+  entry.runAt = task.nextRun;
+  entry.name = name;
+  entry.generation = task.generation;
+  m_timers.push(entry);
+}
+
+void* Scheduler::Process()
+{
+  XBMC->Log(LOG_DEBUG, "Scheduler started.");
+  while (!IsStopped())
+  {
+    std::function<void()> task;
+    uint32_t waitMs = maximumWaitMs;
+    {
+      P8PLATFORM::CLockObject lock(m_mutex);
+      time_t currentTime;
+      time(&currentTime);
+      while (!m_timers.empty())
+      {
+        const TimerEntry &entry = m_timers.top();
+        auto it = m_tasks.find(entry.name);
+        if (it == m_tasks.end() || it->second.generation != entry.generation)
+        {
+          m_timers.pop();
+          continue;
+        }
+        if (entry.runAt > currentTime)
+        {
+          time_t waitSeconds = entry.runAt - currentTime;
+          if (waitSeconds < static_cast<time_t>(maximumWaitMs / 1000))
+          {
+            waitMs = static_cast<uint32_t>(waitSeconds * 1000);
+          }
+          break;
+        }
+        m_timers.pop();
+        task = it->second.task;
+        if (it->second.interval > 0)
+        {
+          it->second.nextRun = currentTime + it->second.interval;
+          Enqueue(it->first, it->second);
+        }
+        else
+        {
+          m_tasks.erase(it);
+        }
+        break;
+      }
+    }
+
+    if (task)
+    {
+      task();
+      continue;
+    }
+    m_wakeup.Wait(waitMs);
+  }
+  XBMC->Log(LOG_DEBUG, "Scheduler stopped.");
+  return nullptr;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <p8-platform/threads/threads.h>
+#include <p8-platform/threads/mutex.h>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+
+class Scheduler: public P8PLATFORM::CThread
+{
+public:
+  Scheduler();
+  ~Scheduler() override;
+  void AddTask(const std::string& name, const std::function<void()>& task,
+      time_t runAt, time_t interval = 0);
+  void RunNoLaterThan(const std::string& name, time_t runAt);
+  void RemoveTask(const std::string& name);
+  bool StopThread(int iWaitMs = 5000) override;
+  void* Process() override;
+
+private:
+  struct ScheduledTask
+  {
+    std::function<void()> task;
+    time_t nextRun;
+    time_t interval;
+    uint64_t generation = 0;
+  };
+
+  struct TimerEntry
+  {
+    time_t runAt;
+    std::string name;
+    uint64_t generation;
+    bool operator>(const TimerEntry& other) const
+    {
+      return runAt > other.runAt;
+    }
+  };
+
+  void Enqueue(const std::string& name, ScheduledTask& task);
+
+  std::map<std::string, ScheduledTask> m_tasks;
+  std::priority_queue<TimerEntry, std::vector<TimerEntry>,
+      std::greater<TimerEntry>> m_timers;
+  P8PLATFORM::CMutex m_mutex;
+  P8PLATFORM::CEvent m_wakeup;
+  // Shared by all tasks, so a removed and re-added task never matches the
+  // timer entries of its predecessor
+  uint64_t m_generation = 0;
+};
@@ -0,0 +1,69 @@
+#include "StringPool.h"
+#include <cstring>
+
+bool StringPool::Key::operator==(const Key& other) const
+{
+  return length == other.length && memcmp(data, other.data, length) == 0;
+}
+
+size_t StringPool::KeyHash::operator()(const Key& key) const
+{
+  // FNV-1a
+  size_t hash = 2166136261u;
+  for (size_t i = 0; i < key.length; i++)
+  {
+    hash = (hash ^ static_cast<unsigned char>(key.data[i])) * 16777619u;
+  }
+  return hash;
+}
+
+StringPool::StringPool()
+{
+  // Id 0 is always the empty string
+  m_strings.emplace_back();
+}
+
+unsigned int StringPool::Intern(const std::string& str)
+{
+  return Intern(str.data(), str.length());
+}
+
+unsigned int StringPool::Intern(const char *str, size_t length)
+{
+  if (length == 0)
+  {
+    return 0;
+  }
+  P8PLATFORM::CLockObject lock(m_mutex);
+  auto it = m_ids.find(Key{ str, length });
+  if (it != m_ids.end())
+  {
+    return it->second;
+  }
+  auto id = static_cast<unsigned int>(m_strings.size());
+  // Elements of a deque keep their address when appending
+  m_strings.emplace_back(str, length);
+  const std::string &pooled = m_strings.back();
+  m_ids.insert(std::make_pair(Key{ pooled.data(), pooled.length() }, id));
+  return id;
+}
+
+const std::string& StringPool::Get(unsigned int id) const
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  return m_strings[id];
+}
+
+size_t StringPool::Size() const
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  return m_strings.size();
+}
+
+void StringPool::Clear()
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  m_ids.clear();
+  m_strings.clear();
+  m_strings.emplace_back();
+}
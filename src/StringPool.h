@@ -0,0 +1,38 @@
+#pragma once
+
+#include <p8-platform/threads/mutex.h>
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+/*!
+ * @brief Stores each distinct string once and refers to it by a compact id
+ */
+class StringPool
+{
+public:
+  StringPool();
+  unsigned int Intern(const std::string& str);
+  unsigned int Intern(const char *str, size_t length);
+  const std::string& Get(unsigned int id) const;
+  size_t Size() const;
+  void Clear();
+
+private:
+  // Refers to the characters of a pooled string, so lookups need no copy
+  struct Key
+  {
+    const char *data;
+    size_t length;
+    bool operator==(const Key& other) const;
+  };
+  struct KeyHash
+  {
+    size_t operator()(const Key& key) const;
+  };
+
+  std::unordered_map<Key, unsigned int, KeyHash> m_ids;
+  std::deque<std::string> m_strings;
+  mutable P8PLATFORM::CMutex m_mutex;
+};
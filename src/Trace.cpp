@@ -0,0 +1,144 @@
+#include "Trace.h"
+#include "client.h"
+#include <chrono>
+#include <cstdio>
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+
+using namespace ADDON;
+using namespace rapidjson;
+
+constexpr char TRACE_FILE[] =
+    "special://profile/addon_data/pvr.zattoo/trace.json";
+// Bounds the events kept between two writes
+const size_t maxEvents = 200000;
+
+std::atomic<bool> Trace::m_enabled(false);
+std::vector<Trace::Event> Trace::m_events;
+std::map<std::thread::id, int> Trace::m_threadIds;
+bool Trace::m_dropping = false;
+bool Trace::m_fileStarted = false;
+P8PLATFORM::CMutex Trace::m_mutex;
+P8PLATFORM::CMutex Trace::m_fileMutex;
+
+void Trace::SetEnabled(bool enabled)
+{
+  if (enabled == IsEnabled())
+  {
+    return;
+  }
+  if (!enabled)
+  {
+    m_enabled = false;
+    Write();
+    P8PLATFORM::CLockObject lock(m_mutex);
+    m_events.clear();
+    m_threadIds.clear();
+    m_dropping = false;
+    return;
+  }
+  XBMC->Log(LOG_NOTICE, "Recording trace to [%s].", TRACE_FILE);
+  {
+    P8PLATFORM::CLockObject lock(m_fileMutex);
+    m_fileStarted = false;
+  }
+  m_enabled = true;
+}
+
+int64_t Trace::Now()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Trace::AddSpan(const char *name, const std::string &detail,
+    int64_t start, int64_t end)
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  if (m_events.size() >= maxEvents)
+  {
+    if (!m_dropping)
+    {
+      XBMC->Log(LOG_NOTICE,
+          "Trace holds %lu events, dropping events until the next write.",
+          static_cast<unsigned long>(maxEvents));
+      m_dropping = true;
+    }
+    return;
+  }
+  auto threadId = m_threadIds.insert(std::make_pair(std::this_thread::get_id(),
+      static_cast<int>(m_threadIds.size()) + 1)).first;
+  m_events.push_back(Event{ name, detail, start, end - start, threadId->second });
+}
+
+/*!
+ * Appends the events since the last write to the trace file in the json
+ * array format. The closing bracket may be missing in this format, so the
+ * file stays valid between writes.
+ */
+void Trace::Write()
+{
+  std::vector<Event> events;
+  {
+    P8PLATFORM::CLockObject lock(m_mutex);
+    events.swap(m_events);
+    m_dropping = false;
+  }
+  if (events.empty())
+  {
+    return;
+  }
+
+  StringBuffer buffer;
+  Writer<StringBuffer> writer(buffer);
+  for (auto const &event : events)
+  {
+    writer.Reset(buffer);
+    writer.StartObject();
+    writer.Key("name");
+    writer.String(event.name);
+    writer.Key("cat");
+    writer.String("pvr.zattoo");
+    writer.Key("ph");
+    writer.String("X");
+    writer.Key("ts");
+    writer.Int64(event.start);
+    writer.Key("dur");
+    writer.Int64(event.duration);
+    writer.Key("pid");
+    writer.Int(1);
+    writer.Key("tid");
+    writer.Int(event.tid);
+    if (!event.detail.empty())
+    {
+      writer.Key("args");
+      writer.StartObject();
+      writer.Key("detail");
+      writer.String(event.detail.c_str());
+      writer.EndObject();
+    }
+    writer.EndObject();
+    buffer.Put(',');
+    buffer.Put('\n');
+  }
+
+  P8PLATFORM::CLockObject lock(m_fileMutex);
+  // A new trace replaces the file of the previous one
+  void *file = XBMC->OpenFileForWrite(TRACE_FILE, !m_fileStarted);
+  if (!file)
+  {
+    XBMC->Log(LOG_ERROR, "Could not write trace to [%s].", TRACE_FILE);
+    return;
+  }
+  if (!m_fileStarted)
+  {
+    XBMC->WriteFile(file, "[\n", 2);
+    m_fileStarted = true;
+  }
+  else
+  {
+    XBMC->SeekFile(file, 0, SEEK_END);
+  }
+  XBMC->WriteFile(file, buffer.GetString(), buffer.GetSize());
+  XBMC->CloseFile(file);
+}
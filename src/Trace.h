@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <p8-platform/threads/mutex.h>
+
+/*!
+ * @brief Records spans of add-on activity as chrome trace events
+ *
+ * The events are appended to trace.json in the add-on data folder on every
+ * Write and can be opened with chrome://tracing or ui.perfetto.dev. When
+ * tracing is disabled a span costs a single atomic load.
+ */
+class Trace
+{
+public:
+  static void SetEnabled(bool enabled);
+  static bool IsEnabled()
+  {
+    return m_enabled.load(std::memory_order_relaxed);
+  }
+  static int64_t Now();
+  static void AddSpan(const char *name, const std::string &detail,
+      int64_t start, int64_t end);
+  static void Write();
+
+private:
+  struct Event
+  {
+    const char *name;
+    std::string detail;
+    int64_t start;
+    int64_t duration;
+    int tid;
+  };
+
+  static std::atomic<bool> m_enabled;
+  static std::vector<Event> m_events;
+  static std::map<std::thread::id, int> m_threadIds;
+  static bool m_dropping;
+  static bool m_fileStarted;
+  static P8PLATFORM::CMutex m_mutex;
+  static P8PLATFORM::CMutex m_fileMutex;
+};
+
+/*!
+ * @brief Adds a span from construction to destruction to the trace
+ */
+class TraceSpan
+{
+public:
+  explicit TraceSpan(const char *name) :
+      m_name(name),
+      m_start(Trace::IsEnabled() ? Trace::Now() : -1)
+  {
+  }
+  TraceSpan(const char *name, const std::string &detail) :
+      m_name(name),
+      m_start(Trace::IsEnabled() ? Trace::Now() : -1)
+  {
+    if (m_start >= 0)
+    {
+      m_detail = detail;
+    }
+  }
+  ~TraceSpan()
+  {
+    if (m_start >= 0)
+    {
+      Trace::AddSpan(m_name, m_detail, m_start, Trace::Now());
+    }
+  }
+
+private:
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+  const char *m_name;
+  std::string m_detail;
+  int64_t m_start;
+};
@@ -2,47 +2,29 @@
 #include <ctime>
 #include "client.h"
 #include "ZatData.h"
-#include "Cache.h"
+#include "Metrics.h"
+#include "Trace.h"
+#include "Utils.h"
 
 using namespace ADDON;
 
-const time_t maximumUpdateInterval = 600;
+const time_t maximumIdleTime = 30;
 
 std::queue<EpgQueueEntry> UpdateThread::loadEpgQueue;
-time_t UpdateThread::nextRecordingsUpdate;
 P8PLATFORM::CMutex UpdateThread::mutex;
+P8PLATFORM::CEvent UpdateThread::queueEvent;
 
 UpdateThread::UpdateThread(int threadIdx, void *zat) :
     CThread(),
     m_zat(zat),
     m_threadIdx(threadIdx)
 {
-  time(&UpdateThread::nextRecordingsUpdate);
-  UpdateThread::nextRecordingsUpdate += maximumUpdateInterval;
   CreateThread(false);
 }
 
 UpdateThread::~UpdateThread()
 = default;
 
-void UpdateThread::SetNextRecordingUpdate(time_t nextRecordingsUpdate)
-{
-  if (nextRecordingsUpdate < UpdateThread::nextRecordingsUpdate)
-  {
-    if (!mutex.Lock())
-    {
-      XBMC->Log(LOG_ERROR,
-          "UpdateThread::SetNextRecordingUpdate : Could not lock mutex.");
-      return;
-    }
-    if (nextRecordingsUpdate < UpdateThread::nextRecordingsUpdate)
-    {
-      UpdateThread::nextRecordingsUpdate = nextRecordingsUpdate;
-    }
-    mutex.Unlock();
-  }
-}
-
 void UpdateThread::LoadEpg(int uniqueChannelId, time_t startTime,
     time_t endTime)
 {
@@ -57,73 +39,78 @@ void UpdateThread::LoadEpg(int uniqueChannelId, time_t startTime,
   }
   loadEpgQueue.push(entry);
   mutex.Unlock();
+  queueEvent.Signal();
+}
+
+size_t UpdateThread::GetEpgQueueSize()
+{
+  if (!mutex.Lock())
+  {
+    XBMC->Log(LOG_ERROR,
+        "UpdateThread::GetEpgQueueSize : Could not lock mutex.");
+    return 0;
+  }
+  size_t size = loadEpgQueue.size();
+  mutex.Unlock();
+  return size;
+}
+
+bool UpdateThread::StopThread(int iWaitMs)
+{
+  CThread::StopThread(-1);
+  queueEvent.Broadcast();
+  return CThread::StopThread(iWaitMs);
+}
+
+bool UpdateThread::NextEpgQueueEntry(EpgQueueEntry &entry)
+{
+  if (!mutex.Lock())
+  {
+    XBMC->Log(LOG_ERROR,
+        "UpdateThread::Process : Could not lock mutex for epg queue");
+    return false;
+  }
+  bool found = !loadEpgQueue.empty();
+  if (found)
+  {
+    entry = loadEpgQueue.front();
+    loadEpgQueue.pop();
+  }
+  mutex.Unlock();
+  return found;
 }
 
 void* UpdateThread::Process()
 {
-  XBMC->Log(LOG_DEBUG, "Update thread started.");
+  XBMC->Log(LOG_DEBUG, "Update thread %d started.", m_threadIdx);
+  time_t lastActivity;
+  time(&lastActivity);
   while (!IsStopped())
   {
-    Sleep(100);
-    if (IsStopped())
+    EpgQueueEntry entry{};
+    if (NextEpgQueueEntry(entry))
     {
+      TraceSpan span("epg job");
+      int64_t started = Utils::GetMonotonicTimeMs();
+      (static_cast<ZatData*>(m_zat))->GetEPGForChannelAsync(entry.uniqueChannelId,
+          entry.startTime, entry.endTime);
+      Metrics::AddDuration("epg job", Utils::GetMonotonicTimeMs() - started);
+      time(&lastActivity);
       continue;
     }
-    
-    if (m_threadIdx == 0) {
-      Cache::Cleanup();
-    }
 
-    while (!loadEpgQueue.empty())
-    {
-      if (!mutex.Lock())
-      {
-        XBMC->Log(LOG_ERROR,
-            "UpdateThread::Process : Could not lock mutex for epg queue");
-        break;
-      }
-      if (!loadEpgQueue.empty())
-      {
-        EpgQueueEntry entry = loadEpgQueue.front();
-        loadEpgQueue.pop();
-        mutex.Unlock();
-        (static_cast<ZatData*>(m_zat))->GetEPGForChannelAsync(entry.uniqueChannelId,
-            entry.startTime, entry.endTime);
-      }
-      else
-      {
-        mutex.Unlock();
-      }
-    }
-    
+    queueEvent.Wait(1000);
+
     time_t currentTime;
     time(&currentTime);
 
-    if (static_cast<ZatData*>(m_zat)->RecordingEnabled() && currentTime >= UpdateThread::nextRecordingsUpdate)
+    // Additional workers only live as long as there is an epg backlog
+    if (m_threadIdx > 0 && currentTime - lastActivity >= maximumIdleTime)
     {
-      if (!mutex.Lock())
-      {
-        XBMC->Log(LOG_ERROR,
-            "UpdateThread::Process : Could not lock mutex for recordings update");
-        continue;
-      }
-      if (currentTime >= UpdateThread::nextRecordingsUpdate)
-      {
-        UpdateThread::nextRecordingsUpdate = currentTime
-            + maximumUpdateInterval;
-        mutex.Unlock();
-        PVR->TriggerTimerUpdate();
-        PVR->TriggerRecordingUpdate();
-        XBMC->Log(LOG_DEBUG, "Update thread triggered update.");
-      }
-      else
-      {
-        mutex.Unlock();
-      }
+      break;
     }
   }
 
-  XBMC->Log(LOG_DEBUG, "Update thread stopped.");
+  XBMC->Log(LOG_DEBUG, "Update thread %d stopped.", m_threadIdx);
   return nullptr;
 }
-
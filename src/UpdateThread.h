@@ -17,14 +17,16 @@ class UpdateThread: public P8PLATFORM::CThread
 public:
   UpdateThread(int threadIdx, void *zat);
   ~UpdateThread() override;
-  static void SetNextRecordingUpdate(time_t nextRecordingsUpdate);
   static void LoadEpg(int uniqueChannelId, time_t startTime, time_t endTime);
+  static size_t GetEpgQueueSize();
+  bool StopThread(int iWaitMs = 5000) override;
   void* Process() override;
 
 private:
+  bool NextEpgQueueEntry(EpgQueueEntry &entry);
   void *m_zat;
   int m_threadIdx;
   static std::queue<EpgQueueEntry> loadEpgQueue;
-  static time_t nextRecordingsUpdate;
   static P8PLATFORM::CMutex mutex;
+  static P8PLATFORM::CEvent queueEvent;
 };
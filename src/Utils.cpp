@@ -1,6 +1,7 @@
 #include "Utils.h"
 
 #include <algorithm>
+#include <chrono>
 #include <iomanip>
 #include <iterator>
 #include <sstream>
@@ -108,24 +109,91 @@ std::string Utils::ReadFile(const std::string& path)
 
 time_t Utils::StringToTime(const std::string &timeString)
 {
-  struct tm tm{};
+  return StringToTime(timeString.c_str(), timeString.length());
+}
 
-  int year, month, day, h, m, s, tzh, tzm;
-  if (sscanf(timeString.c_str(), "%d-%d-%dT%d:%d:%d%d", &year, &month, &day, &h,
-      &m, &s, &tzh) < 7)
+static bool ParseDigits(const char *&c, const char *end, int count, int &value)
+{
+  value = 0;
+  for (int i = 0; i < count; i++, c++)
+  {
+    if (c == end || *c < '0' || *c > '9')
+    {
+      return false;
+    }
+    value = value * 10 + (*c - '0');
+  }
+  return true;
+}
+
+/*!
+ * Parses ISO 8601 times like "2019-01-31T20:45:00Z" or
+ * "2019-01-31T20:45:00.000+01:00". A missing offset means UTC.
+ */
+time_t Utils::StringToTime(const char *timeString, size_t length)
+{
+  const char *c = timeString;
+  const char *end = timeString + length;
+  int year, month, day, hour, minute, second = 0;
+  if (!ParseDigits(c, end, 4, year) || c == end || *c++ != '-'
+      || !ParseDigits(c, end, 2, month) || c == end || *c++ != '-'
+      || !ParseDigits(c, end, 2, day) || c == end
+      || (*c != 'T' && *c != ' ') || !ParseDigits(++c, end, 2, hour)
+      || c == end || *c++ != ':' || !ParseDigits(c, end, 2, minute))
+  {
+    return 0;
+  }
+  if (c != end && *c == ':' && !ParseDigits(++c, end, 2, second))
+  {
+    // Ignore a truncated seconds field instead of using its first digit
+    second = 0;
+  }
+  if (c != end && *c == '.')
   {
-    tzh = 0;
+    for (c++; c != end && *c >= '0' && *c <= '9'; c++);
   }
-  tzm = tzh % 100;
-  tzh = tzh / 100;
-
-  tm.tm_year = year - 1900;
-  tm.tm_mon = month - 1;
-  tm.tm_mday = day;
-  tm.tm_hour = h - tzh;
-  tm.tm_min = m - tzm;
-  tm.tm_sec = s;
-
-  time_t ret = timegm(&tm);
-  return ret;
+
+  int offset = 0;
+  int offsetHours, offsetMinutes = 0;
+  if (c != end && (*c == '+' || *c == '-'))
+  {
+    int sign = *c++ == '-' ? -1 : 1;
+    if (ParseDigits(c, end, 2, offsetHours))
+    {
+      if (c != end && *c == ':')
+      {
+        c++;
+      }
+      if (c == end || !ParseDigits(c, end, 2, offsetMinutes))
+      {
+        offsetMinutes = 0;
+      }
+      offset = sign * (offsetHours * 3600 + offsetMinutes * 60);
+    }
+  }
+
+  int64_t days = DaysFromCivil(year, static_cast<unsigned int>(month),
+      static_cast<unsigned int>(day));
+  return static_cast<time_t>(days * 86400 + hour * 3600 + minute * 60 + second
+      - offset);
+}
+
+// Days since 1970-01-01 of a proleptic gregorian date,
+// http://howardhinnant.github.io/date_algorithms.html#days_from_civil
+int64_t Utils::DaysFromCivil(int year, unsigned int month, unsigned int day)
+{
+  year -= month <= 2;
+  const int64_t era = (year >= 0 ? year : year - 399) / 400;
+  const auto yearOfEra = static_cast<unsigned int>(year - era * 400);
+  const unsigned int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5
+      + day - 1;
+  const unsigned int dayOfEra = yearOfEra * 365 + yearOfEra / 4
+      - yearOfEra / 100 + dayOfYear;
+  return era * 146097 + static_cast<int64_t>(dayOfEra) - 719468;
+}
+
+int64_t Utils::GetMonotonicTimeMs()
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <ctime>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -15,4 +17,7 @@ public:
   static std::vector<std::string> SplitString(const std::string &str,
       const char &delim, int maxParts = 0);
   static time_t StringToTime(const std::string &timeString);
+  static time_t StringToTime(const char *timeString, size_t length);
+  static int64_t DaysFromCivil(int year, unsigned int month, unsigned int day);
+  static int64_t GetMonotonicTimeMs();
 };
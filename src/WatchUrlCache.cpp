@@ -0,0 +1,64 @@
+#include "WatchUrlCache.h"
+
+#ifdef TARGET_ANDROID
+#include "to_string.h"
+#endif
+
+std::string WatchUrlCache::Key(const std::string& id,
+    const std::string& streamType, int64_t timeshift)
+{
+  return id + "|" + streamType + "|" + std::to_string(timeshift);
+}
+
+bool WatchUrlCache::Get(const std::string& key, std::string& url)
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  time_t currentTime;
+  time(&currentTime);
+  auto it = m_urls.find(key);
+  if (it == m_urls.end() || it->second.validUntil <= currentTime)
+  {
+    return false;
+  }
+  url = it->second.url;
+  return true;
+}
+
+bool WatchUrlCache::Contains(const std::string& key)
+{
+  std::string url;
+  return Get(key, url);
+}
+
+void WatchUrlCache::Set(const std::string& key, const std::string& url,
+    time_t validUntil)
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  time_t currentTime;
+  time(&currentTime);
+  RemoveExpired(currentTime);
+  WatchUrl &watchUrl = m_urls[key];
+  watchUrl.url = url;
+  watchUrl.validUntil = validUntil;
+}
+
+void WatchUrlCache::Clear()
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  m_urls.clear();
+}
+
+void WatchUrlCache::RemoveExpired(time_t currentTime)
+{
+  for (auto it = m_urls.begin(); it != m_urls.end();)
+  {
+    if (it->second.validUntil <= currentTime)
+    {
+      it = m_urls.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
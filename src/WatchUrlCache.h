@@ -0,0 +1,33 @@
+#pragma once
+
+#include <p8-platform/threads/mutex.h>
+#include <ctime>
+#include <cstdint>
+#include <map>
+#include <string>
+
+/*!
+ * @brief Stream urls returned by /zapi/watch, reused until they expire
+ */
+class WatchUrlCache
+{
+public:
+  static std::string Key(const std::string& id, const std::string& streamType,
+      int64_t timeshift);
+  bool Get(const std::string& key, std::string& url);
+  bool Contains(const std::string& key);
+  void Set(const std::string& key, const std::string& url, time_t validUntil);
+  void Clear();
+
+private:
+  struct WatchUrl
+  {
+    std::string url;
+    time_t validUntil;
+  };
+
+  void RemoveExpired(time_t currentTime);
+
+  std::map<std::string, WatchUrl> m_urls;
+  P8PLATFORM::CMutex m_mutex;
+};
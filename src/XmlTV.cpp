@@ -1,14 +1,25 @@
 #include "XmlTV.h"
+#include "XmlTVStream.h"
 #include <tinyxml2.h>
-#include <time.h>
+#include <cctype>
+#include <cstring>
+#include <vector>
 
 #include "client.h"
+#include "Utils.h"
+#include "Trace.h"
 
 using namespace tinyxml2;
 using namespace ADDON;
 
-XmlTV::XmlTV(std::string xmlFile) :
-  m_xmlFile(xmlFile)
+const size_t chunkSize = 64 * 1024;
+constexpr char programmeStart[] = "<programme";
+constexpr char programmeEnd[] = "</programme>";
+
+XmlTV::XmlTV(std::string xmlFile, const Categories &categories) :
+  m_xmlFile(xmlFile),
+  m_strings(std::make_shared<StringPool>()),
+  m_categories(categories)
 {
   if (!XBMC->FileExists(m_xmlFile.c_str(), true))
   {
@@ -24,79 +35,329 @@ XmlTV::XmlTV(std::string xmlFile) :
 
 }
 
-bool XmlTV::GetEPGForChannel(const std::string &cid, unsigned int uniqueChannelId)
+std::shared_ptr<const StringPool> XmlTV::GetEPGForChannel(
+    const std::string &cid, int uniqueChannelId, time_t iStart, time_t iEnd,
+    std::vector<PVRIptvEpgEntry> &entries)
 {
-  if (!XBMC->FileExists(m_xmlFile.c_str(), true))
+  P8PLATFORM::CLockObject lock(m_mutex);
+  if (IsOutdated())
   {
-    return false;
+    // A failed read keeps the previous index
+    LoadFile();
   }
 
-  XMLDocument doc;
-  if (doc.LoadFile(m_xmlFile.c_str()) != XML_SUCCESS)
+  auto channel = m_channels.find(cid);
+  if (channel == m_channels.end())
   {
-    XBMC->Log(LOG_ERROR, "XMLTV: failed to parse xml-file.");
-    return false;
+    return nullptr;
+  }
+
+  std::pair<ChannelEpg::const_iterator, ChannelEpg::const_iterator> range =
+      channel->second.GetRange(iStart, iEnd);
+  for (auto it = range.first; it != range.second; ++it)
+  {
+    PVRIptvEpgEntry entry = *it;
+    entry.iChannelId = uniqueChannelId;
+    entries.push_back(entry);
+  }
+  if (range.first == range.second)
+  {
+    return nullptr;
+  }
+  // A reload replaces the pool, so the texts stay valid for the caller
+  return m_strings;
+}
+
+void XmlTV::SetChannels(const std::set<std::string> &cids)
+{
+  P8PLATFORM::CLockObject lock(m_mutex);
+  if (cids != m_wantedChannels)
+  {
+    m_wantedChannels = cids;
+    m_fileSize = -1;
   }
-  XMLElement* tv = doc.FirstChildElement("tv");
-  if (!tv)
+}
+
+bool XmlTV::IsOutdated()
+{
+  struct __stat64 status;
+  if (XBMC->StatFile(m_xmlFile.c_str(), &status) != 0)
+  {
+    return m_fileSize != -1;
+  }
+  auto fileSize = static_cast<int64_t>(status.st_size);
+  auto fileTime = static_cast<int64_t>(status.st_mtime);
+  if (fileSize == m_fileSize && fileTime == m_fileTime)
   {
-    XBMC->Log(LOG_ERROR, "XMLTV: no 'tv' section in xml-file.");
     return false;
   }
-  bool result = false;
-  XMLElement* programme = tv->FirstChildElement("programme");
-  while (programme)
+  m_fileSize = fileSize;
+  m_fileTime = fileTime;
+  return true;
+}
+
+bool XmlTV::LoadFile()
+{
+  TraceSpan span("xmltv load", m_xmlFile);
+  XmlTVStream file;
+  if (!file.Open(m_xmlFile))
   {
-    EPG_TAG tag;
-    memset(&tag, 0, sizeof(EPG_TAG));
+    XBMC->Log(LOG_ERROR, "XMLTV: failed to open xml-file.");
+    m_channels.clear();
+    m_fileSize = -1;
+    return false;
+  }
 
-    XMLElement* title = programme->FirstChildElement("title");
-    const char *start = programme->Attribute("start");
-    const char *stop = programme->Attribute("stop");
-    const char *channel = programme->Attribute("channel");
+  std::map<std::string, ChannelEpg> previousChannels;
+  previousChannels.swap(m_channels);
+  std::shared_ptr<StringPool> previousStrings = m_strings;
+  m_strings = std::make_shared<StringPool>();
 
-    if (!title || !start || !stop || !channel || strcmp(channel, cid.c_str()))
+  // Read the file chunk by chunk and only keep the programme being parsed
+  std::map<std::string, std::vector<PVRIptvEpgEntry>> programmesByChannel;
+  std::vector<char> chunk(chunkSize);
+  std::string buffer;
+  size_t pos = 0;
+  bool eof = false;
+  XMLDocument doc;
+  while (true)
+  {
+    size_t begin = buffer.find(programmeStart, pos);
+    size_t end = begin == std::string::npos ?
+        std::string::npos : buffer.find(programmeEnd, begin);
+    if (end == std::string::npos)
     {
-      programme = programme->NextSiblingElement("programme");
+      if (eof)
+      {
+        break;
+      }
+      if (begin == std::string::npos)
+      {
+        // Keep a possibly truncated start tag at the end of the buffer
+        size_t keep = sizeof(programmeStart) - 2;
+        begin = buffer.size() > keep ? buffer.size() - keep : 0;
+      }
+      buffer.erase(0, begin);
+      pos = 0;
+      ssize_t read = file.Read(chunk.data(), chunk.size());
+      if (read < 0)
+      {
+        // It is read again once it changes
+        XBMC->Log(LOG_ERROR,
+            "XMLTV: failed to read xml-file, keeping the previous programmes.");
+        file.Close();
+        m_channels.swap(previousChannels);
+        m_strings = previousStrings;
+        return false;
+      }
+      if (read == 0)
+      {
+        eof = true;
+      }
+      else
+      {
+        buffer.append(chunk.data(), static_cast<size_t>(read));
+      }
       continue;
     }
+    end += sizeof(programmeEnd) - 1;
+    ParseProgramme(doc, buffer.data() + begin, end - begin,
+        programmesByChannel);
+    pos = end;
+  }
+  file.Close();
 
-    XMLElement* subTitle = programme->FirstChildElement("sub-title");
-    XMLElement* category = programme->FirstChildElement("category");
-    tag.startTime = StringToTime(start);
-    tag.endTime = StringToTime(stop);
-    tag.iUniqueBroadcastId = tag.startTime;
-    tag.strTitle = title->GetText();
-    tag.iUniqueChannelId = uniqueChannelId;
-    if (subTitle)
-    {
-      const char *description = subTitle->GetText();
-      tag.strPlotOutline = description;
-      tag.strPlot = description;
-    }
-    if (category)
+  // Resolve every distinct genre once instead of on each transfer
+  std::map<unsigned int, int> genres;
+  for (auto &item : programmesByChannel)
+  {
+    for (auto &entry : item.second)
     {
-      const char *genre = category->GetText();
-      tag.iGenreType = EPG_GENRE_USE_STRING;
-      tag.strGenreDescription = genre;
+      if (!entry.genreId)
+      {
+        continue;
+      }
+      auto genre = genres.find(entry.genreId);
+      if (genre == genres.end())
+      {
+        genre = genres.emplace(entry.genreId,
+            m_categories.Category(m_strings->Get(entry.genreId))).first;
+      }
+      entry.genre = genre->second;
     }
+    m_channels[item.first].Merge(item.second);
+  }
+  XBMC->Log(LOG_DEBUG, "XMLTV: Indexed programmes of %lu channels.",
+      static_cast<unsigned long>(m_channels.size()));
+  return true;
+}
 
-    result = true;
-    PVR->EpgEventStateChange(&tag, EPG_EVENT_CREATED);
+void XmlTV::ParseProgramme(XMLDocument &doc, const char *data, size_t length,
+    std::map<std::string, std::vector<PVRIptvEpgEntry>> &programmesByChannel)
+{
+  // Check the channel in the start tag before building a DOM for it
+  const char *tagEnd = static_cast<const char*>(memchr(data, '>', length));
+  if (!tagEnd)
+  {
+    return;
+  }
+  std::string startChannel;
+  if (!m_wantedChannels.empty()
+      && ReadAttribute(data, tagEnd, "channel", startChannel)
+      && startChannel.find('&') == std::string::npos
+      && !m_wantedChannels.count(startChannel))
+  {
+    return;
+  }
+
+  if (doc.Parse(data, length) != XML_SUCCESS)
+  {
+    return;
+  }
+  XMLElement* programme = doc.FirstChildElement("programme");
+  if (!programme)
+  {
+    return;
+  }
 
-    programme = programme->NextSiblingElement("programme");
+  XMLElement* title = programme->FirstChildElement("title");
+  const char *start = programme->Attribute("start");
+  const char *stop = programme->Attribute("stop");
+  const char *channel = programme->Attribute("channel");
 
+  if (!title || !start || !stop || !channel)
+  {
+    return;
+  }
+  // Escaped or missing ids could not be checked before parsing
+  if (!m_wantedChannels.empty() && !m_wantedChannels.count(channel))
+  {
+    return;
   }
-  return result;
 
+  XMLElement* subTitle = programme->FirstChildElement("sub-title");
+  XMLElement* category = programme->FirstChildElement("category");
+  PVRIptvEpgEntry entry{};
+  entry.startTime = StringToTime(start);
+  entry.endTime = StringToTime(stop);
+  entry.iBroadcastId = static_cast<int>(entry.startTime);
+  const char *titleText = title->GetText();
+  entry.titleId = titleText ? m_strings->Intern(titleText) : 0;
+  if (subTitle && subTitle->GetText())
+  {
+    entry.plotId = m_strings->Intern(subTitle->GetText());
+  }
+  if (category && category->GetText())
+  {
+    entry.genreId = m_strings->Intern(category->GetText());
+  }
+  programmesByChannel[channel].push_back(entry);
 }
 
-time_t XmlTV::StringToTime(const std::string &timeString)
+/*!
+ * Reads the value of the attribute name from the start tag [tag, tagEnd).
+ * Entities in the value are not decoded.
+ */
+bool XmlTV::ReadAttribute(const char *tag, const char *tagEnd,
+    const char *name, std::string &value)
 {
-  struct tm tm
-  { };
-  strptime(timeString.c_str(), "%Y%m%d%H%M%S", &tm);
-  time_t ret = timegm(&tm);
-  return ret;
+  size_t nameLength = strlen(name);
+  const char *c = tag;
+  // Skip the element name
+  while (c < tagEnd && !isspace(static_cast<unsigned char>(*c)))
+  {
+    c++;
+  }
+  while (c < tagEnd)
+  {
+    while (c < tagEnd && isspace(static_cast<unsigned char>(*c)))
+    {
+      c++;
+    }
+    const char *nameStart = c;
+    while (c < tagEnd && *c != '=' && !isspace(static_cast<unsigned char>(*c)))
+    {
+      c++;
+    }
+    const char *nameEnd = c;
+    while (c < tagEnd && isspace(static_cast<unsigned char>(*c)))
+    {
+      c++;
+    }
+    if (c >= tagEnd || *c != '=')
+    {
+      return false;
+    }
+    c++;
+    while (c < tagEnd && isspace(static_cast<unsigned char>(*c)))
+    {
+      c++;
+    }
+    if (c >= tagEnd || (*c != '"' && *c != '\''))
+    {
+      return false;
+    }
+    const char quote = *c++;
+    const char *valueStart = c;
+    while (c < tagEnd && *c != quote)
+    {
+      c++;
+    }
+    if (c >= tagEnd)
+    {
+      return false;
+    }
+    if (static_cast<size_t>(nameEnd - nameStart) == nameLength
+        && memcmp(nameStart, name, nameLength) == 0)
+    {
+      value.assign(valueStart, c);
+      return true;
+    }
+    c++;
+  }
+  return false;
 }
 
+/*!
+ * Parses xmltv dates like "20190131204500 +0100". Trailing fields of the
+ * date may be omitted and the offset defaults to UTC.
+ */
+time_t XmlTV::StringToTime(const char *timeString)
+{
+  // year, month, day, hour, minute, second
+  const int digits[] = { 4, 2, 2, 2, 2, 2 };
+  int fields[] = { 1970, 1, 1, 0, 0, 0 };
+  const char *c = timeString;
+  for (int i = 0; i < 6; i++)
+  {
+    int value = 0;
+    int j = 0;
+    for (; j < digits[i] && *c >= '0' && *c <= '9'; j++, c++)
+    {
+      value = value * 10 + (*c - '0');
+    }
+    if (j < digits[i])
+    {
+      break;
+    }
+    fields[i] = value;
+  }
+
+  while (*c == ' ')
+  {
+    c++;
+  }
+  int offset = 0;
+  if ((*c == '+' || *c == '-') && isdigit(c[1]) && isdigit(c[2])
+      && isdigit(c[3]) && isdigit(c[4]))
+  {
+    int sign = *c == '-' ? -1 : 1;
+    offset = sign * (((c[1] - '0') * 10 + (c[2] - '0')) * 3600
+        + ((c[3] - '0') * 10 + (c[4] - '0')) * 60);
+  }
+
+  int64_t days = Utils::DaysFromCivil(fields[0],
+      static_cast<unsigned int>(fields[1]), static_cast<unsigned int>(fields[2]));
+  return static_cast<time_t>(days * 86400 + fields[3] * 3600 + fields[4] * 60
+      + fields[5] - offset);
+}
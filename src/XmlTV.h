@@ -1,13 +1,51 @@
 #pragma once
+#include <ctime>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
 #include <string>
+#include <vector>
+#include <p8-platform/threads/mutex.h>
+#include "EpgStore.h"
+#include "StringPool.h"
+#include "categories.h"
+
+namespace tinyxml2
+{
+class XMLDocument;
+}
 
 class XmlTV
 {
 public:
-  XmlTV(std::string xmlFile);
-  bool GetEPGForChannel(const std::string &cid, unsigned int uniqueChannelId);
+  XmlTV(std::string xmlFile, const Categories &categories);
+  /*!
+   * @brief Appends the programs of the channel within [iStart, iEnd) to entries
+   *
+   * @return The pool holding the texts of the programs, or nullptr if the
+   *         channel has no programs in the range
+   */
+  std::shared_ptr<const StringPool> GetEPGForChannel(const std::string &cid,
+      int uniqueChannelId, time_t iStart, time_t iEnd,
+      std::vector<PVRIptvEpgEntry> &entries);
+  void SetChannels(const std::set<std::string> &cids);
 
 private:
+  bool IsOutdated();
+  bool LoadFile();
+  void ParseProgramme(tinyxml2::XMLDocument &doc, const char *data,
+      size_t length,
+      std::map<std::string, std::vector<PVRIptvEpgEntry>> &programmesByChannel);
   std::string m_xmlFile;
-  time_t StringToTime(const std::string &timeString);
+  int64_t m_fileSize = -1;
+  int64_t m_fileTime = 0;
+  std::set<std::string> m_wantedChannels;
+  std::map<std::string, ChannelEpg> m_channels;
+  std::shared_ptr<StringPool> m_strings;
+  const Categories &m_categories;
+  P8PLATFORM::CMutex m_mutex;
+  static time_t StringToTime(const char *timeString);
+  static bool ReadAttribute(const char *tag, const char *tagEnd,
+      const char *name, std::string &value);
 };
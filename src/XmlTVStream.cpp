@@ -0,0 +1,217 @@
+#include "XmlTVStream.h"
+#include "client.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace ADDON;
+
+const size_t inputSize = 64 * 1024;
+const unsigned char gzipMagic[] = { 0x1f, 0x8b };
+const unsigned char xzMagic[] = { 0xfd, '7', 'z', 'X', 'Z', 0x00 };
+
+XmlTVStream::XmlTVStream() :
+    m_file(nullptr),
+    m_compression(COMPRESSION_NONE),
+    m_inputPos(0),
+    m_inputLength(0),
+    m_inputEof(false),
+    m_finished(false)
+{
+  memset(&m_gzip, 0, sizeof(m_gzip));
+#ifdef HAVE_LZMA
+  memset(&m_xz, 0, sizeof(m_xz));
+#endif
+}
+
+XmlTVStream::~XmlTVStream()
+{
+  Close();
+}
+
+bool XmlTVStream::Open(const std::string &file)
+{
+  Close();
+  m_file = XBMC->OpenFile(file.c_str(), 0);
+  if (!m_file)
+  {
+    return false;
+  }
+  m_input.resize(inputSize);
+  if (!FillInput())
+  {
+    return true;
+  }
+
+  const auto *data = reinterpret_cast<const unsigned char*>(m_input.data());
+  if (m_inputLength >= sizeof(gzipMagic)
+      && memcmp(data, gzipMagic, sizeof(gzipMagic)) == 0)
+  {
+    // 32 enables the automatic detection of the gzip header
+    if (inflateInit2(&m_gzip, MAX_WBITS + 32) != Z_OK)
+    {
+      XBMC->Log(LOG_ERROR, "XMLTV: Could not initialize gzip decompression.");
+      Close();
+      return false;
+    }
+    m_compression = COMPRESSION_GZIP;
+  }
+  else if (m_inputLength >= sizeof(xzMagic)
+      && memcmp(data, xzMagic, sizeof(xzMagic)) == 0)
+  {
+#ifdef HAVE_LZMA
+    if (lzma_stream_decoder(&m_xz, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+    {
+      XBMC->Log(LOG_ERROR, "XMLTV: Could not initialize xz decompression.");
+      Close();
+      return false;
+    }
+    m_compression = COMPRESSION_XZ;
+#else
+    XBMC->Log(LOG_ERROR, "XMLTV: xz compressed files are not supported.");
+    Close();
+    return false;
+#endif
+  }
+  return true;
+}
+
+void XmlTVStream::Close()
+{
+  if (m_compression == COMPRESSION_GZIP)
+  {
+    inflateEnd(&m_gzip);
+    memset(&m_gzip, 0, sizeof(m_gzip));
+  }
+#ifdef HAVE_LZMA
+  if (m_compression == COMPRESSION_XZ)
+  {
+    lzma_end(&m_xz);
+    memset(&m_xz, 0, sizeof(m_xz));
+  }
+#endif
+  if (m_file)
+  {
+    XBMC->CloseFile(m_file);
+    m_file = nullptr;
+  }
+  m_compression = COMPRESSION_NONE;
+  m_inputPos = 0;
+  m_inputLength = 0;
+  m_inputEof = false;
+  m_finished = false;
+}
+
+bool XmlTVStream::FillInput()
+{
+  m_inputPos = 0;
+  m_inputLength = 0;
+  if (m_inputEof || !m_file)
+  {
+    return false;
+  }
+  ssize_t read = XBMC->ReadFile(m_file, m_input.data(), m_input.size());
+  if (read <= 0)
+  {
+    m_inputEof = true;
+    return false;
+  }
+  m_inputLength = static_cast<size_t>(read);
+  return true;
+}
+
+ssize_t XmlTVStream::Read(char *buffer, size_t size)
+{
+  if (!m_file || m_finished || size == 0)
+  {
+    return 0;
+  }
+  switch (m_compression)
+  {
+    case COMPRESSION_GZIP:
+      return ReadGzip(buffer, size);
+#ifdef HAVE_LZMA
+    case COMPRESSION_XZ:
+      return ReadXz(buffer, size);
+#endif
+    default:
+      break;
+  }
+
+  if (m_inputPos == m_inputLength && !FillInput())
+  {
+    return 0;
+  }
+  size_t length = std::min(size, m_inputLength - m_inputPos);
+  memcpy(buffer, m_input.data() + m_inputPos, length);
+  m_inputPos += length;
+  return static_cast<ssize_t>(length);
+}
+
+ssize_t XmlTVStream::ReadGzip(char *buffer, size_t size)
+{
+  m_gzip.next_out = reinterpret_cast<Bytef*>(buffer);
+  m_gzip.avail_out = static_cast<uInt>(size);
+  while (m_gzip.avail_out == size)
+  {
+    if (m_inputPos == m_inputLength && !FillInput())
+    {
+      XBMC->Log(LOG_ERROR, "XMLTV: Unexpected end of gzip stream.");
+      m_finished = true;
+      break;
+    }
+    m_gzip.next_in = reinterpret_cast<Bytef*>(m_input.data() + m_inputPos);
+    m_gzip.avail_in = static_cast<uInt>(m_inputLength - m_inputPos);
+    int ret = inflate(&m_gzip, Z_NO_FLUSH);
+    m_inputPos = m_inputLength - m_gzip.avail_in;
+    if (ret == Z_STREAM_END)
+    {
+      // A gzip file may consist of several members
+      if (m_inputPos == m_inputLength && !FillInput())
+      {
+        m_finished = true;
+        break;
+      }
+      inflateReset(&m_gzip);
+    }
+    else if (ret != Z_OK && ret != Z_BUF_ERROR)
+    {
+      XBMC->Log(LOG_ERROR, "XMLTV: gzip decompression failed (%d).", ret);
+      m_finished = true;
+      return -1;
+    }
+  }
+  return static_cast<ssize_t>(size - m_gzip.avail_out);
+}
+
+#ifdef HAVE_LZMA
+ssize_t XmlTVStream::ReadXz(char *buffer, size_t size)
+{
+  m_xz.next_out = reinterpret_cast<uint8_t*>(buffer);
+  m_xz.avail_out = size;
+  while (m_xz.avail_out == size)
+  {
+    if (m_inputPos == m_inputLength)
+    {
+      FillInput();
+    }
+    m_xz.next_in = reinterpret_cast<const uint8_t*>(m_input.data()
+        + m_inputPos);
+    m_xz.avail_in = m_inputLength - m_inputPos;
+    lzma_ret ret = lzma_code(&m_xz, m_inputEof ? LZMA_FINISH : LZMA_RUN);
+    m_inputPos = m_inputLength - m_xz.avail_in;
+    if (ret == LZMA_STREAM_END)
+    {
+      m_finished = true;
+      break;
+    }
+    if (ret != LZMA_OK)
+    {
+      XBMC->Log(LOG_ERROR, "XMLTV: xz decompression failed (%d).",
+          static_cast<int>(ret));
+      m_finished = true;
+      return -1;
+    }
+  }
+  return static_cast<ssize_t>(size - m_xz.avail_out);
+}
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <zlib.h>
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+
+/*!
+ * @brief Sequential reader for xmltv files, decompressing gzip and xz on the fly
+ *
+ * The compression is detected from the first bytes of the file, so the file
+ * name does not matter.
+ */
+class XmlTVStream
+{
+public:
+  XmlTVStream();
+  ~XmlTVStream();
+  bool Open(const std::string &file);
+  void Close();
+
+  /*!
+   * @brief Reads up to size decompressed bytes
+   * @return The number of bytes read, 0 at the end of the file or -1 on errors
+   */
+  ssize_t Read(char *buffer, size_t size);
+
+private:
+  enum Compression
+  {
+    COMPRESSION_NONE,
+    COMPRESSION_GZIP,
+    COMPRESSION_XZ
+  };
+
+  bool FillInput();
+  ssize_t ReadGzip(char *buffer, size_t size);
+#ifdef HAVE_LZMA
+  ssize_t ReadXz(char *buffer, size_t size);
+#endif
+
+  void *m_file;
+  Compression m_compression;
+  std::vector<char> m_input;
+  size_t m_inputPos;
+  size_t m_inputLength;
+  bool m_inputEof;
+  bool m_finished;
+  z_stream m_gzip;
+#ifdef HAVE_LZMA
+  lzma_stream m_xz;
+#endif
+};
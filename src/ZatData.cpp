@@ -4,15 +4,22 @@
 #include <sstream>
 #include "p8-platform/sockets/tcp.h"
 #include <map>
+#include <chrono>
 #include <ctime>
 #include <random>
 #include <utility>
+#include <algorithm>
+#include <functional>
 #include "Utils.h"
 #include "rapidjson/document.h"
 #include "rapidjson/writer.h"
 #include "rapidjson/stringbuffer.h"
 #include "Cache.h"
+#include "EpgDatabase.h"
+#include "Metrics.h"
+#include "Trace.h"
 #include "md5.h"
+#include "kodi_vfs_types.h"
 
 #ifdef TARGET_ANDROID
 #include "to_string.h"
@@ -23,6 +30,29 @@ using namespace rapidjson;
 
 constexpr char app_token_file[] = "special://temp/zattoo_app_token";
 const char data_file[] = "special://profile/addon_data/pvr.zattoo/data.json";
+constexpr char home_logo_dir[] =
+    "special://home/addons/pvr.zattoo/resources/media/channel_logo/";
+constexpr char system_logo_dir[] =
+    "special://xbmc/addons/pvr.zattoo/resources/media/channel_logo/";
+const char channels_file[] =
+    "special://profile/addon_data/pvr.zattoo/channels.json";
+const unsigned int maxEpgWorkers = 8;
+const time_t recordingsUpdateInterval = 600;
+const time_t cacheCleanupInterval = 3600;
+const time_t sessionKeepAliveInterval = 1800;
+const time_t epgRefreshInterval = 6 * 3600;
+const time_t epgDatabaseSaveInterval = 600;
+const time_t epgDatabaseRetention = 2 * 86400;
+// Kodi shows one past day of the guide by default
+const time_t epgPastDays = 86400;
+const time_t metricsDumpInterval = 3600;
+const time_t traceWriteInterval = 300;
+const time_t startupRetryInterval = 300;
+const uint32_t sessionReadyTimeoutMs = 30 * 1000;
+const time_t watchUrlValidity = 60;
+const time_t prefetchDelay = 3;
+const int epgTransferBatchSize = 200;
+const std::chrono::milliseconds epgTransferPause(20);
 static const std::string user_agent = std::string("Kodi/")
     + std::string(STR(KODI_VERSION)) + std::string(" pvr.zattoo/")
     + std::string(STR(ZATTOO_VERSION)) + std::string(" (Kodi PVR addon)");
@@ -30,10 +60,18 @@ static const std::string user_agent = std::string("Kodi/")
 std::string ZatData::HttpGetCached(const std::string& url, time_t cacheDuration,
     const std::string& userAgent)
 {
+  if (m_replaying)
+  {
+    return HttpGet(url, false, userAgent);
+  }
 
   std::string content;
   std::string cacheKey = md5(url);
-  if (!Cache::Read(cacheKey, content))
+  int64_t started = Utils::GetMonotonicTimeMs();
+  bool cached = Cache::Read(cacheKey, content);
+  Metrics::AddDuration("cache read", Utils::GetMonotonicTimeMs() - started);
+  Metrics::AddCacheLookup(cached);
+  if (!cached)
   {
     content = HttpGet(url, false, userAgent);
     if (!content.empty())
@@ -71,14 +109,28 @@ std::string ZatData::HttpRequest(const std::string& action, const std::string& u
 
   curl.AddOption("acceptencoding", "gzip,deflate");
 
-  if (!m_beakerSessionId.empty())
+  // Channels of the snapshot are served before the session is started
+  if (!isInit)
   {
-    curl.AddOption("cookie", "beaker.session.id=" + m_beakerSessionId);
+    m_sessionReady.Wait(sessionReadyTimeoutMs);
   }
 
-  if (!m_pzuid.empty())
+  std::string sessionCookie;
+  std::string pzuidCookie;
+  {
+    P8PLATFORM::CLockObject lock(m_cookieMutex);
+    sessionCookie = m_beakerSessionId;
+    pzuidCookie = m_pzuid;
+  }
+
+  if (!sessionCookie.empty())
   {
-    curl.AddOption("Cookie", "pzuid=" + m_pzuid);
+    curl.AddOption("cookie", "beaker.session.id=" + sessionCookie);
+  }
+
+  if (!pzuidCookie.empty())
+  {
+    curl.AddOption("Cookie", "pzuid=" + pzuidCookie);
   }
 
   if (!userAgent.empty())
@@ -99,18 +151,27 @@ std::string ZatData::HttpRequest(const std::string& action, const std::string& u
     return HttpRequestToCurl(curl, action, url, postData, statusCode);
   }
   std::string sessionId = curl.GetCookie("beaker.session.id");
-  if (!sessionId.empty() && m_beakerSessionId != sessionId)
+  std::string pzuid = curl.GetCookie("pzuid");
+  bool cookiesChanged = false;
   {
-    XBMC->Log(LOG_DEBUG, "Got new beaker.session.id: %s..",
-        sessionId.substr(0, 5).c_str());
-    m_beakerSessionId = sessionId;
-  }
+    P8PLATFORM::CLockObject lock(m_cookieMutex);
+    if (!sessionId.empty() && m_beakerSessionId != sessionId)
+    {
+      XBMC->Log(LOG_DEBUG, "Got new beaker.session.id: %s..",
+          sessionId.substr(0, 5).c_str());
+      m_beakerSessionId = sessionId;
+      cookiesChanged = true;
+    }
 
-  std::string pzuid = curl.GetCookie("pzuid");
-  if (!pzuid.empty() && m_pzuid != pzuid)
+    if (!pzuid.empty() && m_pzuid != pzuid)
+    {
+      XBMC->Log(LOG_DEBUG, "Got new pzuid: %s..", pzuid.substr(0, 5).c_str());
+      m_pzuid = pzuid;
+      cookiesChanged = true;
+    }
+  }
+  if (cookiesChanged)
   {
-    XBMC->Log(LOG_DEBUG, "Got new pzuid: %s..", pzuid.substr(0, 5).c_str());
-    m_pzuid = pzuid;
     WriteDataJson();
   }
 
@@ -121,6 +182,8 @@ std::string ZatData::HttpRequestToCurl(Curl &curl, const std::string& action,
     const std::string& url, const std::string& postData, int &statusCode)
 {
   XBMC->Log(LOG_DEBUG, "Http-Request: %s %s.", action.c_str(), url.c_str());
+  TraceSpan span("fetch", url);
+  int64_t started = Utils::GetMonotonicTimeMs();
   std::string content;
   if (action == "POST")
   {
@@ -134,13 +197,15 @@ std::string ZatData::HttpRequestToCurl(Curl &curl, const std::string& action,
   {
     content = curl.Get(url, statusCode);
   }
+  Metrics::AddRequest(url, content.size(),
+      Utils::GetMonotonicTimeMs() - started, statusCode != 200);
   return content;
 
 }
 
 bool ZatData::ReadDataJson()
 {
-  if (!XBMC->FileExists(data_file, true))
+  if (m_replaying || !XBMC->FileExists(data_file, true))
   {
     return true;
   }
@@ -186,12 +251,26 @@ bool ZatData::ReadDataJson()
     XBMC->Log(LOG_DEBUG, "Loaded uuid: %s", m_uuid.c_str());
   }
 
+  // The session is only reused for the same provider and account
+  if (doc.HasMember("beakerSessionId")
+      && GetStringOrEmpty(doc, "sessionAccount") == GetSessionAccount())
+  {
+    m_beakerSessionId = GetStringOrEmpty(doc, "beakerSessionId");
+    XBMC->Log(LOG_DEBUG, "Loaded beaker.session.id: %s..",
+        m_beakerSessionId.substr(0, 5).c_str());
+  }
+
   XBMC->Log(LOG_DEBUG, "Loaded data.json.");
   return true;
 }
 
 bool ZatData::WriteDataJson()
 {
+  if (m_replaying)
+  {
+    return true;
+  }
+  P8PLATFORM::CLockObject lock(m_cookieMutex);
   void* file;
   if (!(file = XBMC->OpenFileForWrite(data_file, true)))
   {
@@ -238,6 +317,18 @@ bool ZatData::WriteDataJson()
     d.AddMember("uuid", uuidValue, allocator);
   }
 
+  if (!m_beakerSessionId.empty())
+  {
+    Value sessionValue;
+    sessionValue.SetString(m_beakerSessionId.c_str(),
+        m_beakerSessionId.length(), allocator);
+    d.AddMember("beakerSessionId", sessionValue, allocator);
+    std::string account = GetSessionAccount();
+    Value accountValue;
+    accountValue.SetString(account.c_str(), account.length(), allocator);
+    d.AddMember("sessionAccount", accountValue, allocator);
+  }
+
   StringBuffer buffer;
   Writer<StringBuffer> writer(buffer);
   d.Accept(writer);
@@ -259,6 +350,11 @@ std::string ZatData::GetUUID()
   return m_uuid;
 }
 
+std::string ZatData::GetSessionAccount()
+{
+  return md5(m_providerUrl + "\n" + m_username);
+}
+
 std::string ZatData::GenerateUUID()
 {
   std::random_device rd;
@@ -301,7 +397,10 @@ bool ZatData::LoadAppId()
   {
     size_t endPos = html.find("'", basePos);
     m_appToken = html.substr(basePos, endPos - basePos);
+  }
 
+  if (!m_appToken.empty() && !m_replaying)
+  {
     void* file;
     if (!(file = XBMC->OpenFileForWrite(app_token_file, true)))
     {
@@ -314,7 +413,8 @@ bool ZatData::LoadAppId()
     }
   }
 
-  if (m_appToken.empty() && XBMC->FileExists(app_token_file, true))
+  if (m_appToken.empty() && !m_replaying
+      && XBMC->FileExists(app_token_file, true))
   {
     XBMC->Log(LOG_NOTICE,
         "Could not get app token from page. Try to load from file.");
@@ -373,6 +473,11 @@ Document ZatData::Login()
 
 bool ZatData::InitSession()
 {
+  P8PLATFORM::CLockObject sessionLock(m_sessionMutex);
+
+  // Stream urls belong to the previous session
+  m_watchUrls.Clear();
+
   std::string jsonString = HttpGet(m_providerUrl + "/zapi/v2/session", true);
   Document doc;
   doc.Parse(jsonString.c_str());
@@ -385,8 +490,11 @@ bool ZatData::InitSession()
   if (!doc["session"]["loggedin"].GetBool())
   {
     XBMC->Log(LOG_DEBUG, "Need to login.");
-    m_pzuid = "";
-    m_beakerSessionId = "";
+    {
+      P8PLATFORM::CLockObject lock(m_cookieMutex);
+      m_pzuid = "";
+      m_beakerSessionId = "";
+    }
     WriteDataJson();
     doc = Login();
     if (doc.GetParseError() || !doc["success"].GetBool()
@@ -401,43 +509,216 @@ bool ZatData::InitSession()
     }
   }
 
-  const Value& session = doc["session"];
+  ApplySession(doc["session"]);
+  return true;
+}
 
-  m_countryCode = GetStringOrEmpty(session, "aliased_country_code");
-  m_serviceRegionCountry = GetStringOrEmpty(session, "service_region_country");
-  m_recallEnabled = session["recall_eligible"].GetBool();
-  m_selectiveRecallEnabled =
+bool ZatData::ResumeSession()
+{
+  std::string jsonString = HttpGet(m_providerUrl + "/zapi/v2/session", true);
+  Document doc;
+  doc.Parse(jsonString.c_str());
+  if (!IsLoggedIn(doc))
+  {
+    return false;
+  }
+  ApplySession(doc["session"]);
+  return true;
+}
+
+void ZatData::ApplySession(const Value& session)
+{
+  ZatSession zatSession;
+  zatSession.countryCode = GetStringOrEmpty(session, "aliased_country_code");
+  zatSession.serviceRegionCountry =
+      GetStringOrEmpty(session, "service_region_country");
+  zatSession.recallEnabled = session["recall_eligible"].GetBool();
+  zatSession.selectiveRecallEnabled =
       session.HasMember("selective_recall_eligible") ?
           session["selective_recall_eligible"].GetBool() : false;
-  m_recordingEnabled = session["recording_eligible"].GetBool();
-  XBMC->Log(LOG_NOTICE, "Country code: %s", m_countryCode.c_str());
+  zatSession.recordingEnabled = session["recording_eligible"].GetBool();
+  zatSession.powerHash = GetStringOrEmpty(session, "power_guide_hash");
+  XBMC->Log(LOG_NOTICE, "Country code: %s", zatSession.countryCode.c_str());
   XBMC->Log(LOG_NOTICE, "Service region country: %s",
-      m_serviceRegionCountry.c_str());
+      zatSession.serviceRegionCountry.c_str());
   XBMC->Log(LOG_NOTICE, "Stream type: %s", m_streamType.c_str());
-  if (m_recallEnabled)
+  if (zatSession.recallEnabled)
   {
-    m_maxRecallSeconds = session["recall_seconds"].GetInt();
-    XBMC->Log(LOG_NOTICE, "Recall is enabled for %d seconds.",
-        m_maxRecallSeconds);
+    zatSession.maxRecallSeconds = session["recall_seconds"].GetInt();
+    XBMC->Log(LOG_NOTICE, "Recall is enabled for %lld seconds.",
+        static_cast<long long>(zatSession.maxRecallSeconds));
   }
   else
   {
     XBMC->Log(LOG_NOTICE, "Recall is disabled");
   }
   XBMC->Log(LOG_NOTICE, "Selective recall is %s",
-      m_selectiveRecallEnabled ? "enabled" : "disabled");
+      zatSession.selectiveRecallEnabled ? "enabled" : "disabled");
   XBMC->Log(LOG_NOTICE, "Recordings are %s",
-      m_recordingEnabled ? "enabled" : "disabled");
-  m_powerHash = GetStringOrEmpty(session, "power_guide_hash");
-  return true;
+      zatSession.recordingEnabled ? "enabled" : "disabled");
+
+  P8PLATFORM::CLockObject lock(m_sessionDataMutex);
+  std::swap(m_session, zatSession);
+}
+
+ZatSession ZatData::GetSession()
+{
+  P8PLATFORM::CLockObject lock(m_sessionDataMutex);
+  return m_session;
+}
+
+bool ZatData::IsLoggedIn(const Document& doc)
+{
+  if (doc.GetParseError() || !doc.IsObject() || !doc.HasMember("success")
+      || !doc["success"].GetBool() || !doc.HasMember("session"))
+  {
+    return false;
+  }
+  const Value& session = doc["session"];
+  return session.IsObject() && session.HasMember("loggedin")
+      && session["loggedin"].IsBool() && session["loggedin"].GetBool();
+}
+
+void ZatData::KeepSessionAlive()
+{
+  std::string jsonString = HttpGet(m_providerUrl + "/zapi/v2/session", true);
+  Document doc;
+  doc.Parse(jsonString.c_str());
+  if (IsLoggedIn(doc))
+  {
+    return;
+  }
+  XBMC->Log(LOG_NOTICE, "Session expired. Try to re-init session.");
+  if (!InitSession())
+  {
+    XBMC->Log(LOG_ERROR, "Re-init of session. Failed.");
+  }
+}
+
+void ZatData::RefreshRecordings()
+{
+  if (!GetSession().recordingEnabled)
+  {
+    return;
+  }
+  PVR->TriggerTimerUpdate();
+  PVR->TriggerRecordingUpdate();
+  XBMC->Log(LOG_DEBUG, "Scheduler triggered recordings update.");
+}
+
+void ZatData::RefreshEpg()
+{
+  time_t currentTime;
+  time(&currentTime);
+  std::vector<int> uniqueIds;
+  {
+    P8PLATFORM::CLockObject lock(m_channelsMutex);
+    for (auto const &item : m_channelsByUid)
+    {
+      // Channels updated within the interval still have a current guide
+      if (m_epgStore.IsChannelOutdated(item.first,
+          currentTime - epgRefreshInterval))
+      {
+        uniqueIds.push_back(item.first);
+      }
+    }
+  }
+  for (int uniqueId : uniqueIds)
+  {
+    PVR->TriggerEpgUpdate(static_cast<unsigned int>(uniqueId));
+  }
+  XBMC->Log(LOG_DEBUG, "Scheduler triggered epg update of %lu channels.",
+      static_cast<unsigned long>(uniqueIds.size()));
+}
+
+void ZatData::ScheduleTasks()
+{
+  time_t currentTime;
+  time(&currentTime);
+  m_scheduler->AddTask("recordings", [this]() { RefreshRecordings(); },
+      currentTime + recordingsUpdateInterval, recordingsUpdateInterval);
+  m_scheduler->AddTask("cache", [this]()
+  {
+    if (!m_replaying)
+    {
+      Cache::Cleanup();
+    }
+    PruneEpgStore();
+  }, currentTime, cacheCleanupInterval);
+  m_scheduler->AddTask("session", [this]() { KeepSessionAlive(); },
+      currentTime + sessionKeepAliveInterval, sessionKeepAliveInterval);
+  m_scheduler->AddTask("epg", [this]() { RefreshEpg(); },
+      currentTime + epgRefreshInterval, epgRefreshInterval);
+  m_scheduler->AddTask("epgdatabase", [this]() { SaveEpgDatabase(); },
+      currentTime + epgDatabaseSaveInterval, epgDatabaseSaveInterval);
+  m_scheduler->AddTask("metrics", []() { Metrics::Dump(); },
+      currentTime + metricsDumpInterval, metricsDumpInterval);
+  m_scheduler->AddTask("trace", []()
+  {
+    if (Trace::IsEnabled())
+    {
+      Trace::Write();
+    }
+  }, currentTime + traceWriteInterval, traceWriteInterval);
+}
+
+void ZatData::PruneEpgStore()
+{
+  time_t currentTime;
+  time(&currentTime);
+  size_t pruned = m_epgStore.Prune(currentTime - epgPastDays);
+  XBMC->Log(LOG_DEBUG, "Pruned %lu past programs, %lu programs remain.",
+      static_cast<unsigned long>(pruned),
+      static_cast<unsigned long>(m_epgStore.Size()));
+}
+
+void ZatData::SaveEpgDatabase()
+{
+  if (m_replaying)
+  {
+    return;
+  }
+  std::set<std::pair<int, time_t>> partitions =
+      m_epgStore.TakeDirtyPartitions();
+  for (auto const &partition : partitions)
+  {
+    ZatChannel channel;
+    if (FindChannel(partition.first, channel))
+    {
+      EpgDatabase::Save(channel.cid, partition.first, partition.second,
+          m_epgStore);
+    }
+  }
+  if (!partitions.empty())
+  {
+    XBMC->Log(LOG_DEBUG, "Saved %lu epg database partitions.",
+        static_cast<unsigned long>(partitions.size()));
+  }
+
+  time_t currentTime;
+  time(&currentTime);
+  EpgDatabase::Cleanup(currentTime - epgDatabaseRetention);
 }
 
 bool ZatData::LoadChannels()
 {
   std::map<std::string, ZatChannel> allChannels;
-  std::string jsonString = HttpGet(m_providerUrl + "/zapi/channels/favorites");
+
+  // Favorites and channels do not depend on each other, fetch them at once
+  std::string favoritesJson;
+  std::thread favoritesThread([this, &favoritesJson]()
+  {
+    favoritesJson = HttpGet(m_providerUrl + "/zapi/channels/favorites");
+  });
+
+  std::ostringstream urlStream;
+  urlStream << m_providerUrl + "/zapi/v2/cached/channels/"
+      << GetSession().powerHash << "?details=False";
+  std::string jsonString = HttpGet(urlStream.str());
+  favoritesThread.join();
+
   Document favDoc;
-  favDoc.Parse(jsonString.c_str());
+  favDoc.Parse(favoritesJson.c_str());
 
   if (favDoc.GetParseError() || !favDoc["success"].GetBool())
   {
@@ -445,11 +726,6 @@ bool ZatData::LoadChannels()
   }
   const Value& favs = favDoc["favorites"];
 
-  std::ostringstream urlStream;
-  urlStream << m_providerUrl + "/zapi/v2/cached/channels/" << m_powerHash
-      << "?details=False";
-  jsonString = HttpGet(urlStream.str());
-
   Document doc;
   doc.Parse(jsonString.c_str());
   if (doc.GetParseError() || !doc["success"].GetBool())
@@ -458,6 +734,9 @@ bool ZatData::LoadChannels()
     return false;
   }
 
+  std::vector<PVRZattooChannelGroup> channelGroups;
+  std::map<int, ZatChannel> channelsByUid;
+  std::map<std::string, ZatChannel> channelsByCid;
   int channelNumber = favs.Size();
   const Value& groups = doc["channel_groups"];
 
@@ -498,14 +777,14 @@ bool ZatData::LoadChannels()
                   channelItem["recording"].GetBool() : false;
           group.channels.insert(group.channels.end(), channel);
           allChannels[cid] = channel;
-          m_channelsByCid[channel.cid] = channel;
-          m_channelsByUid[channel.iUniqueId] = channel;
+          channelsByCid[channel.cid] = channel;
+          channelsByUid[channel.iUniqueId] = channel;
           break;
         }
       }
     }
     if (!m_favoritesOnly && !group.channels.empty())
-      m_channelGroups.insert(m_channelGroups.end(), group);
+      channelGroups.insert(channelGroups.end(), group);
   }
 
   PVRZattooChannelGroup favGroup;
@@ -520,17 +799,305 @@ bool ZatData::LoadChannels()
       ZatChannel channel = allChannels[favCid];
       channel.iChannelNumber = static_cast<int>(favGroup.channels.size() + 1);
       favGroup.channels.insert(favGroup.channels.end(), channel);
-      m_channelsByCid[channel.cid] = channel;
-      m_channelsByUid[channel.iUniqueId] = channel;
+      channelsByCid[channel.cid] = channel;
+      channelsByUid[channel.iUniqueId] = channel;
     }
   }
 
   if (!favGroup.channels.empty())
-    m_channelGroups.insert(m_channelGroups.end(), favGroup);
+    channelGroups.insert(channelGroups.end(), favGroup);
 
+  ApplyChannels(channelGroups, channelsByUid, channelsByCid);
+  SaveChannelSnapshot();
   return true;
 }
 
+void ZatData::ApplyChannels(std::vector<PVRZattooChannelGroup>& channelGroups,
+    std::map<int, ZatChannel>& channelsByUid,
+    std::map<std::string, ZatChannel>& channelsByCid)
+{
+  ResolveIconPaths(channelGroups, channelsByUid, channelsByCid);
+
+  bool channelsChanged;
+  bool groupsChanged;
+  std::set<int> uniqueIds;
+  std::set<std::string> cids;
+  {
+    P8PLATFORM::CLockObject lock(m_channelsMutex);
+    // Kodi only needs to reload what differs from the channels it already has
+    bool hadChannels = !m_channelsByUid.empty();
+    channelsChanged = hadChannels && m_channelsByUid != channelsByUid;
+    groupsChanged = hadChannels && m_channelGroups != channelGroups;
+    m_channelGroups.swap(channelGroups);
+    m_channelsByUid.swap(channelsByUid);
+    m_channelsByCid.swap(channelsByCid);
+    for (auto const &item : m_channelsByUid)
+    {
+      uniqueIds.insert(item.first);
+    }
+    for (auto const &item : m_channelsByCid)
+    {
+      cids.insert(item.first);
+    }
+  }
+  // The guide of removed channels is no longer requested
+  m_epgStore.RetainChannels(uniqueIds);
+
+  if (channelsChanged)
+  {
+    XBMC->Log(LOG_DEBUG, "Channels changed, trigger channel update.");
+    PVR->TriggerChannelUpdate();
+  }
+  if (groupsChanged)
+  {
+    XBMC->Log(LOG_DEBUG, "Channel groups changed, trigger group update.");
+    PVR->TriggerChannelGroupsUpdate();
+  }
+
+  // Indexing the XMLTV file must not hold up channel lookups
+  if (m_xmlTV)
+  {
+    m_xmlTV->SetChannels(cids);
+  }
+}
+
+void ZatData::ResolveIconPaths(
+    std::vector<PVRZattooChannelGroup>& channelGroups,
+    std::map<int, ZatChannel>& channelsByUid,
+    std::map<std::string, ZatChannel>& channelsByCid)
+{
+  // The logo directories are listed once instead of probing every channel
+  if (!m_logoIndexLoaded)
+  {
+    ListLogos(home_logo_dir, m_homeLogos);
+    ListLogos(system_logo_dir, m_systemLogos);
+    m_logoIndexLoaded = true;
+  }
+
+  size_t fallbacks = 0;
+  auto resolve = [&](ZatChannel& channel)
+  {
+    std::string file = channel.cid + ".png";
+    if (m_homeLogos.count(file))
+    {
+      channel.iconPath = home_logo_dir + file;
+    }
+    else if (m_systemLogos.count(file))
+    {
+      channel.iconPath = system_logo_dir + file;
+    }
+    else
+    {
+      channel.iconPath = channel.strLogoPath;
+      return false;
+    }
+    return true;
+  };
+  for (auto &item : channelsByCid)
+  {
+    if (!resolve(item.second))
+    {
+      XBMC->Log(LOG_DEBUG,
+          "No logo found for channel '%s'. Fallback to Zattoo-Logo.",
+          item.first.c_str());
+      fallbacks++;
+    }
+  }
+  for (auto &item : channelsByUid)
+  {
+    resolve(item.second);
+  }
+  for (auto &group : channelGroups)
+  {
+    for (auto &channel : group.channels)
+    {
+      resolve(channel);
+    }
+  }
+  if (fallbacks > 0)
+  {
+    XBMC->Log(LOG_INFO, "No logo found for %lu channels, using Zattoo logos.",
+        static_cast<unsigned long>(fallbacks));
+  }
+}
+
+void ZatData::ListLogos(const char *directory, std::set<std::string>& logos)
+{
+  VFSDirEntry *items;
+  unsigned int itemCount;
+  if (!XBMC->GetDirectory(directory, ".png", &items, &itemCount))
+  {
+    return;
+  }
+  for (unsigned int i = 0; i < itemCount; i++)
+  {
+    if (!items[i].folder)
+    {
+      logos.insert(items[i].label);
+    }
+  }
+  XBMC->FreeDirectory(items, itemCount);
+  XBMC->Log(LOG_DEBUG, "Found %lu channel logos in %s.",
+      static_cast<unsigned long>(logos.size()), directory);
+}
+
+bool ZatData::LoadChannelSnapshot()
+{
+  if (m_replaying || !XBMC->FileExists(channels_file, true))
+  {
+    return false;
+  }
+  std::string jsonString = Utils::ReadFile(channels_file);
+  Document doc;
+  doc.Parse(jsonString.c_str());
+  if (doc.GetParseError() || !doc.IsObject()
+      || GetStringOrEmpty(doc, "account") != GetSessionAccount()
+      || !doc.HasMember("session") || !doc.HasMember("groups")
+      || !doc.HasMember("favoritesOnly")
+      || doc["favoritesOnly"].GetBool() != m_favoritesOnly)
+  {
+    XBMC->Log(LOG_DEBUG, "Ignoring outdated or invalid channel snapshot.");
+    return false;
+  }
+
+  const Value& session = doc["session"];
+  ZatSession zatSession;
+  zatSession.powerHash = GetStringOrEmpty(session, "powerHash");
+  zatSession.countryCode = GetStringOrEmpty(session, "countryCode");
+  zatSession.serviceRegionCountry =
+      GetStringOrEmpty(session, "serviceRegionCountry");
+  zatSession.recallEnabled = session["recallEnabled"].GetBool();
+  zatSession.selectiveRecallEnabled =
+      session["selectiveRecallEnabled"].GetBool();
+  zatSession.recordingEnabled = session["recordingEnabled"].GetBool();
+  zatSession.maxRecallSeconds = session["maxRecallSeconds"].GetInt64();
+  {
+    P8PLATFORM::CLockObject lock(m_sessionDataMutex);
+    std::swap(m_session, zatSession);
+  }
+
+  std::vector<PVRZattooChannelGroup> channelGroups;
+  std::map<int, ZatChannel> channelsByUid;
+  std::map<std::string, ZatChannel> channelsByCid;
+  const Value& groups = doc["groups"];
+  for (Value::ConstValueIterator itr = groups.Begin(); itr != groups.End();
+      ++itr)
+  {
+    PVRZattooChannelGroup group;
+    group.name = GetStringOrEmpty(*itr, "name");
+    const Value& channels = (*itr)["channels"];
+    for (Value::ConstValueIterator itr1 = channels.Begin();
+        itr1 != channels.End(); ++itr1)
+    {
+      const Value& channelItem = (*itr1);
+      ZatChannel channel;
+      channel.cid = GetStringOrEmpty(channelItem, "cid");
+      channel.name = GetStringOrEmpty(channelItem, "name");
+      channel.strLogoPath = GetStringOrEmpty(channelItem, "logo");
+      channel.iUniqueId = channelItem["uid"].GetInt();
+      channel.iChannelNumber = channelItem["number"].GetInt();
+      channel.selectiveRecallSeconds =
+          channelItem["selectiveRecallSeconds"].GetInt();
+      channel.recordingEnabled = channelItem["recordingEnabled"].GetBool();
+      group.channels.push_back(channel);
+      // Later groups win, like the favourites numbering in LoadChannels
+      channelsByCid[channel.cid] = channel;
+      channelsByUid[channel.iUniqueId] = channel;
+    }
+    channelGroups.push_back(group);
+  }
+  if (channelsByUid.empty())
+  {
+    return false;
+  }
+
+  XBMC->Log(LOG_DEBUG, "Loaded %lu channels from snapshot.",
+      static_cast<unsigned long>(channelsByUid.size()));
+  ApplyChannels(channelGroups, channelsByUid, channelsByCid);
+  return true;
+}
+
+void ZatData::SaveChannelSnapshot()
+{
+  if (m_replaying)
+  {
+    return;
+  }
+  StringBuffer buffer;
+  Writer<StringBuffer> writer(buffer);
+  std::string account = GetSessionAccount();
+  writer.StartObject();
+  writer.Key("account");
+  writer.String(account.c_str());
+  writer.Key("favoritesOnly");
+  writer.Bool(m_favoritesOnly);
+
+  ZatSession session = GetSession();
+  writer.Key("session");
+  writer.StartObject();
+  writer.Key("powerHash");
+  writer.String(session.powerHash.c_str());
+  writer.Key("countryCode");
+  writer.String(session.countryCode.c_str());
+  writer.Key("serviceRegionCountry");
+  writer.String(session.serviceRegionCountry.c_str());
+  writer.Key("recallEnabled");
+  writer.Bool(session.recallEnabled);
+  writer.Key("selectiveRecallEnabled");
+  writer.Bool(session.selectiveRecallEnabled);
+  writer.Key("recordingEnabled");
+  writer.Bool(session.recordingEnabled);
+  writer.Key("maxRecallSeconds");
+  writer.Int64(session.maxRecallSeconds);
+  writer.EndObject();
+
+  writer.Key("groups");
+  writer.StartArray();
+  {
+    P8PLATFORM::CLockObject lock(m_channelsMutex);
+    for (auto const &group : m_channelGroups)
+    {
+      writer.StartObject();
+      writer.Key("name");
+      writer.String(group.name.c_str());
+      writer.Key("channels");
+      writer.StartArray();
+      for (auto const &channel : group.channels)
+      {
+        writer.StartObject();
+        writer.Key("cid");
+        writer.String(channel.cid.c_str());
+        writer.Key("name");
+        writer.String(channel.name.c_str());
+        writer.Key("logo");
+        writer.String(channel.strLogoPath.c_str());
+        writer.Key("uid");
+        writer.Int(channel.iUniqueId);
+        writer.Key("number");
+        writer.Int(channel.iChannelNumber);
+        writer.Key("selectiveRecallSeconds");
+        writer.Int(channel.selectiveRecallSeconds);
+        writer.Key("recordingEnabled");
+        writer.Bool(channel.recordingEnabled);
+        writer.EndObject();
+      }
+      writer.EndArray();
+      writer.EndObject();
+    }
+  }
+  writer.EndArray();
+  writer.EndObject();
+
+  void *file = XBMC->OpenFileForWrite(channels_file, true);
+  if (!file)
+  {
+    XBMC->Log(LOG_ERROR, "Save channel snapshot failed.");
+    return;
+  }
+  XBMC->WriteFile(file, buffer.GetString(), buffer.GetSize());
+  XBMC->CloseFile(file);
+}
+
 int ZatData::GetChannelId(const char * strChannelName)
 {
   int iId = 0;
@@ -542,23 +1109,28 @@ int ZatData::GetChannelId(const char * strChannelName)
 
 int ZatData::GetChannelGroupsAmount()
 {
+  P8PLATFORM::CLockObject lock(m_channelsMutex);
   return static_cast<int>(m_channelGroups.size());
 }
 
 ZatData::ZatData(const std::string& u, const std::string& p, bool favoritesOnly,
     bool alternativeEpgService, const std::string& streamType, int provider,
-    const std::string& xmlTVFile) :
+    const std::string& xmlTVFile, bool xmlTVPreferred, int epgWorkers) :
     m_alternativeEpgService(alternativeEpgService),
+    m_xmlTVPreferred(xmlTVPreferred),
     m_favoritesOnly(favoritesOnly),
     m_streamType(streamType),
     m_username(u),
     m_password(p)
 {
   XBMC->Log(LOG_NOTICE, "Using useragent: %s", user_agent.c_str());
-  for (int i = 0; i < 5; ++i)
-  {
-    m_updateThreads.emplace_back(new UpdateThread(i, this));
-  }
+
+  m_maxUpdateThreads = epgWorkers > 0 ?
+      static_cast<unsigned int>(epgWorkers) : std::thread::hardware_concurrency();
+  m_maxUpdateThreads = std::max(1u, std::min(m_maxUpdateThreads, maxEpgWorkers));
+  XBMC->Log(LOG_DEBUG, "Using up to %u epg worker threads.", m_maxUpdateThreads);
+  m_updateThreads.emplace_back(new UpdateThread(0, this));
+  m_scheduler = new Scheduler();
 
   switch (provider)
   {
@@ -608,20 +1180,25 @@ ZatData::ZatData(const std::string& u, const std::string& p, bool favoritesOnly,
     m_providerUrl = "https://zattoo.com";
   }
 
+  m_replaying = Curl::GetTrafficMode() == TRAFFIC_REPLAY;
   ReadDataJson();
   if (!xmlTVFile.empty())
   {
-    m_xmlTV = new XmlTV(xmlTVFile);
+    m_xmlTV = new XmlTV(xmlTVFile, m_categories);
   }
+  ScheduleTasks();
 }
 
 ZatData::~ZatData()
 {
+  delete m_scheduler;
+  P8PLATFORM::CLockObject lock(m_updateThreadsMutex);
   for (auto const &updateThread : m_updateThreads)
   {
     updateThread->StopThread(200);
     delete updateThread;
   }
+  SaveEpgDatabase();
   for (auto const& item : m_recordingsData)
   {
     delete item.second;
@@ -635,6 +1212,57 @@ ZatData::~ZatData()
 
 bool ZatData::Initialize()
 {
+  bool started = StartSession();
+  // Requests waiting for the session continue, even if it failed
+  m_sessionReady.Broadcast();
+  return started;
+}
+
+void ZatData::InitializeAsync()
+{
+  time_t currentTime;
+  time(&currentTime);
+  m_scheduler->AddTask("startup", [this]() { RefreshSessionAndChannels(); },
+      currentTime);
+}
+
+void ZatData::RefreshSessionAndChannels()
+{
+  if (Initialize() && LoadChannels())
+  {
+    XBMC->Log(LOG_DEBUG, "Refreshed session and channels.");
+    return;
+  }
+  XBMC->Log(LOG_ERROR, "Refreshing session and channels failed.");
+  // Retries fail the same way as long as the network is down
+  if (!m_startupFailed)
+  {
+    XBMC->QueueNotification(QUEUE_ERROR, XBMC->GetLocalizedString(37111));
+    m_startupFailed = true;
+  }
+  time_t currentTime;
+  time(&currentTime);
+  m_scheduler->AddTask("startup", [this]() { RefreshSessionAndChannels(); },
+      currentTime + startupRetryInterval);
+}
+
+bool ZatData::StartSession()
+{
+  // A session of the last run that is still logged in spares downloading the
+  // app token, the hello and the login
+  if (!m_beakerSessionId.empty() && XBMC->FileExists(app_token_file, true))
+  {
+    m_appToken = Utils::ReadFile(app_token_file);
+    if (!m_appToken.empty() && ResumeSession())
+    {
+      XBMC->Log(LOG_DEBUG, "Resumed previous session.");
+      return true;
+    }
+    XBMC->Log(LOG_NOTICE, "Previous session expired. Start a new one.");
+    P8PLATFORM::CLockObject lock(m_cookieMutex);
+    m_beakerSessionId = "";
+  }
+
   if (!LoadAppId())
   {
     return false;
@@ -650,12 +1278,14 @@ bool ZatData::Initialize()
 
 void ZatData::GetAddonCapabilities(PVR_ADDON_CAPABILITIES* pCapabilities)
 {
-  pCapabilities->bSupportsRecordings = m_recordingEnabled;
-  pCapabilities->bSupportsTimers = m_recordingEnabled;
+  bool recordingEnabled = GetSession().recordingEnabled;
+  pCapabilities->bSupportsRecordings = recordingEnabled;
+  pCapabilities->bSupportsTimers = recordingEnabled;
 }
 
 PVR_ERROR ZatData::GetChannelGroups(ADDON_HANDLE handle)
 {
+  P8PLATFORM::CLockObject lock(m_channelsMutex);
   std::vector<PVRZattooChannelGroup>::iterator it;
   for (it = m_channelGroups.begin(); it != m_channelGroups.end(); ++it)
   {
@@ -686,6 +1316,7 @@ PVRZattooChannelGroup *ZatData::FindGroup(const std::string &strName)
 PVR_ERROR ZatData::GetChannelGroupMembers(ADDON_HANDLE handle,
     const PVR_CHANNEL_GROUP &group)
 {
+  P8PLATFORM::CLockObject lock(m_channelsMutex);
   PVRZattooChannelGroup *myGroup;
   if ((myGroup = FindGroup(group.strGroupName)) != nullptr)
   {
@@ -712,11 +1343,13 @@ PVR_ERROR ZatData::GetChannelGroupMembers(ADDON_HANDLE handle,
 
 int ZatData::GetChannelsAmount()
 {
+  P8PLATFORM::CLockObject lock(m_channelsMutex);
   return static_cast<int>(m_channelsByCid.size());
 }
 
 PVR_ERROR ZatData::GetChannels(ADDON_HANDLE handle, bool bRadio)
 {
+  P8PLATFORM::CLockObject lock(m_channelsMutex);
   std::vector<PVRZattooChannelGroup>::iterator it;
   for (it = m_channelGroups.begin(); it != m_channelGroups.end(); ++it)
   {
@@ -736,28 +1369,7 @@ PVR_ERROR ZatData::GetChannels(ADDON_HANDLE handle, bool bRadio)
           sizeof(kodiChannel.strChannelName) - 1);
       kodiChannel.iEncryptionSystem = 0;
 
-      std::ostringstream iconStream;
-      iconStream
-          << "special://home/addons/pvr.zattoo/resources/media/channel_logo/"
-          << channel.cid << ".png";
-      std::string iconPath = iconStream.str();
-      if (!XBMC->FileExists(iconPath.c_str(), true))
-      {
-        std::ostringstream iconStreamSystem;
-        iconStreamSystem
-            << "special://xbmc/addons/pvr.zattoo/resources/media/channel_logo/"
-            << channel.cid << ".png";
-        iconPath = iconStreamSystem.str();
-        if (!XBMC->FileExists(iconPath.c_str(), true))
-        {
-          XBMC->Log(LOG_INFO,
-              "No logo found for channel '%s'. Fallback to Zattoo-Logo.",
-              channel.cid.c_str());
-          iconPath = channel.strLogoPath;
-        }
-      }
-
-      strncpy(kodiChannel.strIconPath, iconPath.c_str(),
+      strncpy(kodiChannel.strIconPath, channel.iconPath.c_str(),
           sizeof(kodiChannel.strIconPath) - 1);
 
       kodiChannel.bIsHidden = false;
@@ -771,20 +1383,61 @@ PVR_ERROR ZatData::GetChannels(ADDON_HANDLE handle, bool bRadio)
 
 std::string ZatData::GetChannelStreamUrl(int uniqueId)
 {
+  ZatChannel channel;
+  if (!FindChannel(uniqueId, channel))
+  {
+    return "";
+  }
 
-  ZatChannel *channel = FindChannel(uniqueId);
-  XBMC->Log(LOG_DEBUG, "Get live url for channel %s", channel->cid.c_str());
+  std::string url = FetchChannelStreamUrl(channel.cid);
+
+  // Waits for the zap to settle, a later channel replaces the pending prefetch
+  time_t currentTime;
+  time(&currentTime);
+  m_scheduler->AddTask("prefetch",
+      [this, uniqueId]() { PrefetchChannelStreamUrls(uniqueId); },
+      currentTime + prefetchDelay);
+  return url;
+}
+
+std::string ZatData::ChannelWatchUrlKey(const std::string& cid)
+{
+  ZatSession session = GetSession();
+  int64_t timeshift = session.recallEnabled ? session.maxRecallSeconds : 0;
+  return WatchUrlCache::Key("cid:" + cid, m_streamType, timeshift);
+}
+
+std::string ZatData::FetchChannelStreamUrl(const std::string& cid)
+{
+  ZatSession session = GetSession();
+  std::string key = ChannelWatchUrlKey(cid);
+  std::string url;
+  if (m_watchUrls.Get(key, url))
+  {
+    XBMC->Log(LOG_DEBUG, "Use cached live url for channel %s", cid.c_str());
+    return url;
+  }
+
+  XBMC->Log(LOG_DEBUG, "Get live url for channel %s", cid.c_str());
 
   std::ostringstream dataStream;
-  dataStream << "cid=" << channel->cid << "&stream_type=" << m_streamType
+  dataStream << "cid=" << cid << "&stream_type=" << m_streamType
       << "&format=json";
 
-  if (m_recallEnabled)
+  if (session.recallEnabled)
   {
-    dataStream << "&timeshift=" << m_maxRecallSeconds;
+    dataStream << "&timeshift=" << session.maxRecallSeconds;
   }
 
-  std::string jsonString = HttpPost(m_providerUrl + "/zapi/watch", dataStream.str());
+  url = WatchRequest(m_providerUrl + "/zapi/watch", dataStream.str(), key);
+  XBMC->Log(LOG_DEBUG, "Got url: %s", url.c_str());
+  return url;
+}
+
+std::string ZatData::WatchRequest(const std::string& url,
+    const std::string& postData, const std::string& cacheKey)
+{
+  std::string jsonString = HttpPost(url, postData);
 
   Document doc;
   doc.Parse(jsonString.c_str());
@@ -792,38 +1445,92 @@ std::string ZatData::GetChannelStreamUrl(int uniqueId)
   {
     return "";
   }
-  std::string url = GetStringOrEmpty(doc["stream"], "url");
-  XBMC->Log(LOG_DEBUG, "Got url: %s", url.c_str());
-  return url;
-
+  std::string streamUrl = GetStringOrEmpty(doc["stream"], "url");
+  if (!streamUrl.empty())
+  {
+    time_t currentTime;
+    time(&currentTime);
+    m_watchUrls.Set(cacheKey, streamUrl, currentTime + watchUrlValidity);
+  }
+  return streamUrl;
 }
 
-ZatChannel *ZatData::FindChannel(int uniqueId)
+void ZatData::PrefetchChannelStreamUrls(int uniqueId)
 {
-  std::vector<PVRZattooChannelGroup>::iterator it;
-  for (it = m_channelGroups.begin(); it != m_channelGroups.end(); ++it)
+  // Zapping goes to the channel before or after the current one
+  std::vector<int> candidates;
   {
-    std::vector<ZatChannel>::iterator it2;
-    for (it2 = it->channels.begin(); it2 != it->channels.end(); ++it2)
+    P8PLATFORM::CLockObject lock(m_channelsMutex);
+    for (auto const &group : m_channelGroups)
     {
-      ZatChannel &channel = (*it2);
-      if (channel.iUniqueId == uniqueId)
+      auto const &channels = group.channels;
+      for (size_t i = 0; i < channels.size(); i++)
       {
-        return &channel;
+        if (channels[i].iUniqueId != uniqueId)
+        {
+          continue;
+        }
+        size_t count = channels.size();
+        candidates.push_back(channels[(i + 1) % count].iUniqueId);
+        candidates.push_back(channels[(i + count - 1) % count].iUniqueId);
+        break;
+      }
+      if (!candidates.empty())
+      {
+        break;
       }
     }
   }
-  return nullptr;
+
+  for (int candidate : candidates)
+  {
+    ZatChannel channel;
+    if (candidate != uniqueId && FindChannel(candidate, channel)
+        && !m_watchUrls.Contains(ChannelWatchUrlKey(channel.cid)))
+    {
+      FetchChannelStreamUrl(channel.cid);
+    }
+  }
+}
+
+bool ZatData::FindChannel(int uniqueId, ZatChannel& channel)
+{
+  P8PLATFORM::CLockObject lock(m_channelsMutex);
+  auto it = m_channelsByUid.find(uniqueId);
+  if (it == m_channelsByUid.end())
+  {
+    return false;
+  }
+  channel = it->second;
+  return true;
+}
+
+bool ZatData::FindChannelByCid(const std::string& cid, ZatChannel& channel)
+{
+  P8PLATFORM::CLockObject lock(m_channelsMutex);
+  auto it = m_channelsByCid.find(cid);
+  if (it == m_channelsByCid.end())
+  {
+    return false;
+  }
+  channel = it->second;
+  return true;
 }
 
 void ZatData::GetEPGForChannelExternalService(int uniqueChannelId,
     time_t iStart, time_t iEnd)
 {
-  ZatChannel *zatChannel = FindChannel(uniqueChannelId);
-  std::string cid = zatChannel->cid;
+  ZatChannel zatChannel;
+  if (!FindChannel(uniqueChannelId, zatChannel))
+  {
+    return;
+  }
+  std::string cid = zatChannel.cid;
+  m_sessionReady.Wait(sessionReadyTimeoutMs);
+  ZatSession session = GetSession();
   std::ostringstream urlStream;
   urlStream << "http://zattoo.buehlmann.net/epg/api/Epg/"
-      << m_serviceRegionCountry << "/" << m_powerHash << "/" << cid << "/" << iStart
+      << session.serviceRegionCountry << "/" << session.powerHash << "/" << cid << "/" << iStart
       << "/" << iEnd;
   std::string jsonString = HttpGetCached(urlStream.str(), 3600, user_agent);
   Document doc;
@@ -839,30 +1546,32 @@ void ZatData::GetEPGForChannelExternalService(int uniqueChannelId,
     memset(&tag, 0, sizeof(EPG_TAG));
 
     tag.iUniqueBroadcastId = static_cast<unsigned int>(program["Id"].GetInt());
-    std::string title = GetStringOrEmpty(program, "Title");
-    tag.strTitle = title.c_str();
-    tag.iUniqueChannelId = static_cast<unsigned int>(zatChannel->iUniqueId);
-    tag.startTime = Utils::StringToTime(GetStringOrEmpty(program, "StartTime"));
-    tag.endTime = Utils::StringToTime(GetStringOrEmpty(program, "EndTime"));
-    std::string description = GetStringOrEmpty(program, "Description");
-    tag.strPlotOutline = description.c_str();
-    tag.strPlot = description.c_str();
+    tag.strTitle = GetCStringOrEmpty(program, "Title");
+    tag.iUniqueChannelId = static_cast<unsigned int>(zatChannel.iUniqueId);
+    size_t length;
+    const char *timeString = GetCStringOrEmpty(program, "StartTime", &length);
+    tag.startTime = Utils::StringToTime(timeString, length);
+    timeString = GetCStringOrEmpty(program, "EndTime", &length);
+    tag.endTime = Utils::StringToTime(timeString, length);
+    const char *description = GetCStringOrEmpty(program, "Description");
+    tag.strPlotOutline = description;
+    tag.strPlot = description;
     tag.strOriginalTitle = nullptr; /* not supported */
     tag.strCast = nullptr; /* not supported */
     tag.strDirector = nullptr; /*SA not supported */
     tag.strWriter = nullptr; /* not supported */
     tag.iYear = 0; /* not supported */
     tag.strIMDBNumber = nullptr; /* not supported */
-    tag.strIconPath = GetStringOrEmpty(program, "ImageUrl").c_str();
+    tag.strIconPath = GetCStringOrEmpty(program, "ImageUrl");
     tag.iParentalRating = 0; /* not supported */
     tag.iStarRating = 0; /* not supported */
     tag.bNotify = false; /* not supported */
     tag.iSeriesNumber = 0; /* not supported */
     tag.iEpisodeNumber = 0; /* not supported */
     tag.iEpisodePartNumber = 0; /* not supported */
-    tag.strEpisodeName = GetStringOrEmpty(program, "Subtitle").c_str();
+    tag.strEpisodeName = GetCStringOrEmpty(program, "Subtitle");
     tag.iFlags = EPG_TAG_FLAG_UNDEFINED;
-    std::string genreStr = GetStringOrEmpty(program, "Genre");
+    const char *genreStr = GetCStringOrEmpty(program, "Genre");
     int genre = m_categories.Category(genreStr);
     if (genre)
     {
@@ -873,7 +1582,7 @@ void ZatData::GetEPGForChannelExternalService(int uniqueChannelId,
     {
       tag.iGenreType = EPG_GENRE_USE_STRING;
       tag.iGenreSubType = 0; /* not supported */
-      tag.strGenreDescription = genreStr.c_str();
+      tag.strGenreDescription = genreStr;
     }
 
     PVR->EpgEventStateChange(&tag, EPG_EVENT_CREATED);
@@ -881,127 +1590,253 @@ void ZatData::GetEPGForChannelExternalService(int uniqueChannelId,
 
 }
 
-void ZatData::GetEPGForChannel(const PVR_CHANNEL &channel, time_t iStart,
-    time_t iEnd)
+void ZatData::GetEPGForChannel(ADDON_HANDLE handle, const PVR_CHANNEL &channel,
+    time_t iStart, time_t iEnd)
 {
+  int uniqueChannelId = static_cast<int>(channel.iUniqueId);
+  if (!m_alternativeEpgService && !(m_xmlTV && m_xmlTVPreferred)
+      && !m_replaying && m_epgStore.MarkRestored(uniqueChannelId))
+  {
+    // Serve the guide from disk right away, the update thread refreshes it
+    ZatChannel channel;
+    if (FindChannel(uniqueChannelId, channel)
+        && EpgDatabase::Load(channel.cid, uniqueChannelId, iStart, iEnd,
+            m_epgStore))
+    {
+      int count = TransferEpgEntries(handle, uniqueChannelId, iStart, iEnd);
+      XBMC->Log(LOG_DEBUG, "Restored %d programs of channel '%s' from disk.",
+          count, channel.cid.c_str());
+    }
+  }
   UpdateThread::LoadEpg(channel.iUniqueId, iStart, iEnd);
+  ScaleUpdateThreads();
+}
+
+void ZatData::ScaleUpdateThreads()
+{
+  P8PLATFORM::CLockObject lock(m_updateThreadsMutex);
+
+  // The first thread is permanent, idle workers stop on their own
+  for (auto it = m_updateThreads.begin() + 1; it != m_updateThreads.end();)
+  {
+    if ((*it)->IsRunning())
+    {
+      ++it;
+      continue;
+    }
+    delete *it;
+    it = m_updateThreads.erase(it);
+  }
+
+  size_t pending = UpdateThread::GetEpgQueueSize();
+  while (m_updateThreads.size() < m_maxUpdateThreads
+      && m_updateThreads.size() < pending)
+  {
+    int threadIdx = static_cast<int>(m_updateThreads.size());
+    XBMC->Log(LOG_DEBUG, "Start epg worker thread %d for %lu pending jobs.",
+        threadIdx, static_cast<unsigned long>(pending));
+    m_updateThreads.emplace_back(new UpdateThread(threadIdx, this));
+  }
 }
 
 void ZatData::GetEPGForChannelAsync(int uniqueChannelId, time_t iStart,
     time_t iEnd)
 {
-  ZatChannel *zatChannel = FindChannel(uniqueChannelId);
-
-  if (m_xmlTV && m_xmlTV->GetEPGForChannel(zatChannel->cid, uniqueChannelId))
+  ZatChannel zatChannel;
+  if (!FindChannel(uniqueChannelId, zatChannel))
   {
     return;
   }
 
-  if (m_alternativeEpgService)
+  // XMLTV is queried once, its programs are handed on to the transfer
+  std::vector<PVRIptvEpgEntry> xmlTVEntries;
+  std::shared_ptr<const StringPool> xmlTVStrings;
+  if (m_xmlTV)
   {
+    xmlTVStrings = m_xmlTV->GetEPGForChannel(zatChannel.cid, uniqueChannelId,
+        iStart, iEnd, xmlTVEntries);
+  }
+
+  if (m_alternativeEpgService && !xmlTVStrings)
+  {
+    // The external service is only used where XMLTV has no programs
     GetEPGForChannelExternalService(uniqueChannelId, iStart, iEnd);
     return;
   }
 
-  std::map<time_t, PVRIptvEpgEntry>* channelEpgCache = LoadEPG(iStart, iEnd,
-      uniqueChannelId);
-  if (channelEpgCache == nullptr)
+  // Windows filled by preferred XMLTV programs are not fetched from Zattoo
+  if (!LoadEPG(iStart, iEnd,
+      xmlTVStrings && m_xmlTVPreferred ? &xmlTVEntries : nullptr))
   {
     XBMC->Log(LOG_NOTICE, "Loading epg faild for channel '%s' from %lu to %lu",
-        zatChannel->name.c_str(), iStart, iEnd);
-    return;
+        zatChannel.name.c_str(), iStart, iEnd);
   }
-  for (auto const &entry : *channelEpgCache)
+  TransferEpgEntries(nullptr, uniqueChannelId, iStart, iEnd, xmlTVEntries,
+      xmlTVStrings);
+}
+
+int ZatData::TransferEpgEntries(ADDON_HANDLE handle, int uniqueChannelId,
+    time_t iStart, time_t iEnd,
+    const std::vector<PVRIptvEpgEntry> &xmlTVEntries,
+    const std::shared_ptr<const StringPool> &xmlTVStrings)
+{
+  TraceSpan span("transfer");
+  // Copy the programs, so Kodi is not called with the store locked
+  std::vector<PVRIptvEpgEntry> entries;
+  std::shared_ptr<StringPool> strings = m_epgStore.CopyRange(
+      uniqueChannelId, iStart, iEnd, entries);
+
+  std::vector<const PVRIptvEpgEntry*> merged;
+  if (xmlTVStrings)
   {
-    PVRIptvEpgEntry epgEntry = entry.second;
+    merged = m_xmlTVPreferred ?
+        EpgStore::MergeSources(xmlTVEntries, entries) :
+        EpgStore::MergeSources(entries, xmlTVEntries);
+  }
+  else
+  {
+    merged.reserve(entries.size());
+    for (auto const &entry : entries)
+    {
+      merged.push_back(&entry);
+    }
+  }
+  // XMLTV programs keep their texts in the pool of the XMLTV file
+  std::less<const PVRIptvEpgEntry*> before;
+  const PVRIptvEpgEntry *xmlTVBegin = xmlTVEntries.data();
+  const PVRIptvEpgEntry *xmlTVEnd = xmlTVBegin + xmlTVEntries.size();
 
-    EPG_TAG tag;
-    memset(&tag, 0, sizeof(EPG_TAG));
+  // Fields which are not supported stay zero for all programs
+  EPG_TAG tag;
+  memset(&tag, 0, sizeof(EPG_TAG));
+  tag.iUniqueChannelId = static_cast<unsigned int>(uniqueChannelId);
+  tag.iFlags = EPG_TAG_FLAG_UNDEFINED;
 
+  int transferred = 0;
+  for (const PVRIptvEpgEntry *entry : merged)
+  {
+    const PVRIptvEpgEntry &epgEntry = *entry;
+    const StringPool &pool =
+        !before(entry, xmlTVBegin) && before(entry, xmlTVEnd) ?
+        *xmlTVStrings : *strings;
     tag.iUniqueBroadcastId = static_cast<unsigned int>(epgEntry.iBroadcastId);
-    tag.strTitle = epgEntry.strTitle.c_str();
-    tag.iUniqueChannelId = static_cast<unsigned int>(epgEntry.iChannelId);
+    tag.strTitle = pool.Get(epgEntry.titleId).c_str();
     tag.startTime = epgEntry.startTime;
     tag.endTime = epgEntry.endTime;
-    tag.strPlotOutline = epgEntry.strPlot.c_str(); //epgEntry.strPlotOutline.c_str();
-    tag.strPlot = epgEntry.strPlot.c_str();
-    tag.strOriginalTitle = nullptr; /* not supported */
-    tag.strCast = nullptr; /* not supported */
-    tag.strDirector = nullptr; /*SA not supported */
-    tag.strWriter = nullptr; /* not supported */
-    tag.iYear = 0; /* not supported */
-    tag.strIMDBNumber = nullptr; /* not supported */
-    tag.strIconPath = epgEntry.strIconPath.c_str();
-    tag.iParentalRating = 0; /* not supported */
-    tag.iStarRating = 0; /* not supported */
-    tag.bNotify = false; /* not supported */
-    tag.iSeriesNumber = 0; /* not supported */
-    tag.iEpisodeNumber = 0; /* not supported */
-    tag.iEpisodePartNumber = 0; /* not supported */
-    tag.strEpisodeName = nullptr; /* not supported */
-    tag.iFlags = EPG_TAG_FLAG_UNDEFINED;
-
-    int genre = m_categories.Category(epgEntry.strGenreString);
-    if (genre)
+    const char *plot = pool.Get(epgEntry.plotId).c_str();
+    tag.strPlotOutline = plot;
+    tag.strPlot = plot;
+    tag.strIconPath = pool.Get(epgEntry.iconPathId).c_str();
+    if (epgEntry.genre)
     {
-      tag.iGenreSubType = genre & 0x0F;
-      tag.iGenreType = genre & 0xF0;
+      tag.iGenreSubType = epgEntry.genre & 0x0F;
+      tag.iGenreType = epgEntry.genre & 0xF0;
+      tag.strGenreDescription = nullptr;
     }
     else
     {
       tag.iGenreType = EPG_GENRE_USE_STRING;
       tag.iGenreSubType = 0; /* not supported */
-      tag.strGenreDescription = epgEntry.strGenreString.c_str();
+      tag.strGenreDescription = pool.Get(epgEntry.genreId).c_str();
     }
 
+    if (handle)
+    {
+      PVR->TransferEpgEntry(handle, &tag);
+      continue;
+    }
     PVR->EpgEventStateChange(&tag, EPG_EVENT_CREATED);
+    // Give Kodi's epg database time to catch up with the events
+    if (++transferred % epgTransferBatchSize == 0)
+    {
+      std::this_thread::sleep_for(epgTransferPause);
+    }
   }
-  delete channelEpgCache;
+  return static_cast<int>(merged.size());
 }
 
-std::map<time_t, PVRIptvEpgEntry>* ZatData::LoadEPG(time_t iStart, time_t iEnd,
-    int uniqueChannelId)
+int ZatData::ResolveGenre(const std::shared_ptr<StringPool>& strings,
+    unsigned int genreId)
+{
+  if (!genreId)
+  {
+    return 0;
+  }
+  P8PLATFORM::CLockObject lock(m_genresMutex);
+  // Ids are only valid within their pool
+  if (strings != m_genresPool)
+  {
+    m_genresById.clear();
+    m_genresPool = strings;
+  }
+  auto it = m_genresById.find(genreId);
+  if (it != m_genresById.end())
+  {
+    return it->second;
+  }
+  int genre = m_categories.Category(strings->Get(genreId));
+  m_genresById[genreId] = genre;
+  return genre;
+}
+
+bool ZatData::LoadEPG(time_t iStart, time_t iEnd,
+    const std::vector<PVRIptvEpgEntry> *covered)
 {
   //Do some time magic that the start date is not to far in the past because zattoo doesnt like that
   time_t tempStart = iStart - (iStart % (3600 / 2)) - 86400;
   time_t tempEnd = tempStart + 3600 * 5; //Add 5 hours
 
-  auto *epgCache = new std::map<time_t, PVRIptvEpgEntry>();
-
+  // The power hash of a channel snapshot may be outdated until then
+  m_sessionReady.Wait(sessionReadyTimeoutMs);
+  std::string powerHash = GetSession().powerHash;
   while (tempEnd <= iEnd)
   {
+    if (m_epgStore.IsWindowLoaded(tempStart)
+        || (covered && EpgStore::Covers(*covered, std::max(tempStart, iStart),
+            std::min(tempEnd, iEnd))))
+    {
+      tempStart = tempEnd;
+      tempEnd = tempStart + 3600 * 5; //Add 5 hours
+      continue;
+    }
+
     std::ostringstream urlStream;
     urlStream << m_providerUrl << "/zapi/v2/cached/program/power_guide/"
-        << m_powerHash << "?end=" << tempEnd << "&start=" << tempStart
+        << powerHash << "?end=" << tempEnd << "&start=" << tempStart
         << "&format=json";
 
     std::string jsonString = HttpGetCached(urlStream.str(), 3600);
 
     Document doc;
-    doc.Parse(jsonString.c_str());
+    {
+      TraceSpan parseSpan("parse");
+      doc.Parse(jsonString.c_str());
+    }
     if (doc.GetParseError() || !doc["success"].GetBool())
     {
-      return nullptr;
+      return false;
     }
 
+    TraceSpan ingestSpan("ingest");
+    std::shared_ptr<StringPool> strings = m_epgStore.GetStrings();
     const Value& channels = doc["channels"];
 
-    //Load the channel groups and channels
+    //Store the programs of all channels, not only the requested one
     for (Value::ConstValueIterator itr = channels.Begin();
         itr != channels.End(); ++itr)
     {
       const Value& channelItem = (*itr);
       std::string cid = GetStringOrEmpty(channelItem, "cid");
 
-      int channelId = GetChannelId(cid.c_str());
-      ZatChannel *channel = FindChannel(channelId);
-
-      if (!channel || channel->iUniqueId != uniqueChannelId)
+      ZatChannel channel;
+      if (!FindChannelByCid(cid, channel))
       {
         continue;
       }
 
       const Value& programs = channelItem["programs"];
+      std::vector<PVRIptvEpgEntry> entries;
+      entries.reserve(programs.Size());
       for (Value::ConstValueIterator itr1 = programs.Begin();
           itr1 != programs.End(); ++itr1)
       {
@@ -1012,29 +1847,42 @@ std::map<time_t, PVRIptvEpgEntry>* ZatData::LoadEPG(time_t iStart, time_t iEnd,
           continue;
 
         PVRIptvEpgEntry entry;
-        entry.strTitle = GetStringOrEmpty(program, "t");
+        size_t length;
+        const char *value = GetCStringOrEmpty(program, "t", &length);
+        entry.titleId = strings->Intern(value, length);
         entry.startTime = program["s"].GetInt();
         entry.endTime = program["e"].GetInt();
         entry.iBroadcastId = program["id"].GetInt();
-        entry.strIconPath = GetStringOrEmpty(program, "i_url");
-        entry.iChannelId = channel->iUniqueId;
-        entry.strPlot = GetStringOrEmpty(program, "et");
+        value = GetCStringOrEmpty(program, "i_url", &length);
+        entry.iconPathId = strings->Intern(value, length);
+        entry.iChannelId = channel.iUniqueId;
+        value = GetCStringOrEmpty(program, "et", &length);
+        entry.plotId = strings->Intern(value, length);
+        entry.genreId = 0;
 
         const Value& genres = program["g"];
         for (Value::ConstValueIterator itr2 = genres.Begin();
             itr2 != genres.End(); ++itr2)
         {
-          entry.strGenreString = (*itr2).GetString();
+          entry.genreId = strings->Intern((*itr2).GetString(),
+              (*itr2).GetStringLength());
           break;
         }
+        entry.genre = ResolveGenre(strings, entry.genreId);
 
-        (*epgCache)[entry.startTime] = entry;
+        entries.push_back(entry);
       }
+      m_epgStore.Merge(channel.iUniqueId, entries, strings);
     }
+
+    time_t validUntil;
+    time(&validUntil);
+    m_epgStore.SetWindowLoaded(tempStart, validUntil + 3600);
+
     tempStart = tempEnd;
     tempEnd = tempStart + 3600 * 5; //Add 5 hours
   }
-  return epgCache;
+  return true;
 }
 
 void ZatData::SetRecordingPlayCount(const PVR_RECORDING &recording, int count)
@@ -1094,6 +1942,7 @@ int ZatData::GetRecordingLastPlayedPosition(const PVR_RECORDING &recording)
 
 void ZatData::GetRecordings(ADDON_HANDLE handle, bool future)
 {
+  TraceSpan span(future ? "timers" : "recordings");
   std::string jsonString = HttpGetCached(m_providerUrl + "/zapi/playlist", 60);
 
   Document doc;
@@ -1111,13 +1960,14 @@ void ZatData::GetRecordings(ADDON_HANDLE handle, bool future)
   std::string idList;
 
   std::map<int, ZatRecordingDetails> detailsById;
+  std::string powerHash = GetSession().powerHash;
   Value::ConstValueIterator recordingsItr = recordings.Begin();
   while (recordingsItr != recordings.End())
   {
     int bucketSize = 100;
     std::ostringstream urlStream;
     urlStream << m_providerUrl << "/zapi/v2/cached/program/power_details/"
-        << m_powerHash << "?complete=True&program_ids=";
+        << powerHash << "?complete=True&program_ids=";
     while (bucketSize > 0 && recordingsItr != recordings.End())
     {
       const Value& recording = (*recordingsItr);
@@ -1169,14 +2019,13 @@ void ZatData::GetRecordings(ADDON_HANDLE handle, bool future)
     int programId = recording["program_id"].GetInt();
 
     std::string cid = GetStringOrEmpty(recording, "cid");
-    auto iterator = m_channelsByCid.find(cid);
-    if (iterator == m_channelsByCid.end())
+    ZatChannel channel;
+    if (!FindChannelByCid(cid, channel))
     {
       XBMC->Log(LOG_ERROR, "Channel %s not found for recording: %i",
           cid.c_str(), programId);
       continue;
     }
-    ZatChannel channel = iterator->second;
 
     auto detailIterator = detailsById.find(programId);
     bool hasDetails = detailIterator != detailsById.end();
@@ -1188,19 +2037,19 @@ void ZatData::GetRecordings(ADDON_HANDLE handle, bool future)
       genre = m_categories.Category(detailIterator->second.genre);
     }
 
-    time_t startTime = Utils::StringToTime(
-        GetStringOrEmpty(recording, "start"));
+    size_t length;
+    const char *timeString = GetCStringOrEmpty(recording, "start", &length);
+    time_t startTime = Utils::StringToTime(timeString, length);
     if (future && (startTime > current_time))
     {
       PVR_TIMER tag;
       memset(&tag, 0, sizeof(PVR_TIMER));
 
       tag.iClientIndex = static_cast<unsigned int>(recording["id"].GetInt());
-      PVR_STRCPY(tag.strTitle, GetStringOrEmpty(recording, "title").c_str());
-      PVR_STRCPY(tag.strSummary,
-          GetStringOrEmpty(recording, "episode_title").c_str());
-      time_t endTime = Utils::StringToTime(
-          GetStringOrEmpty(recording, "end").c_str());
+      PVR_STRCPY(tag.strTitle, GetCStringOrEmpty(recording, "title"));
+      PVR_STRCPY(tag.strSummary, GetCStringOrEmpty(recording, "episode_title"));
+      timeString = GetCStringOrEmpty(recording, "end", &length);
+      time_t endTime = Utils::StringToTime(timeString, length);
       tag.startTime = startTime;
       tag.endTime = endTime;
       tag.state = PVR_TIMER_STATE_SCHEDULED;
@@ -1208,7 +2057,7 @@ void ZatData::GetRecordings(ADDON_HANDLE handle, bool future)
       tag.iEpgUid = static_cast<unsigned int>(recording["program_id"].GetInt());
       tag.iClientChannelUid = channel.iUniqueId;
       PVR->TransferTimerEntry(handle, &tag);
-      UpdateThread::SetNextRecordingUpdate(startTime);
+      m_scheduler->RunNoLaterThan("recordings", startTime);
       if (genre)
       {
         tag.iGenreSubType = genre & 0x0F;
@@ -1224,17 +2073,16 @@ void ZatData::GetRecordings(ADDON_HANDLE handle, bool future)
 
       PVR_STRCPY(tag.strRecordingId,
           std::to_string(recording["id"].GetInt()).c_str());
-      PVR_STRCPY(tag.strTitle, GetStringOrEmpty(recording, "title").c_str());
+      PVR_STRCPY(tag.strTitle, GetCStringOrEmpty(recording, "title"));
       PVR_STRCPY(tag.strEpisodeName,
-          GetStringOrEmpty(recording, "episode_title").c_str());
+          GetCStringOrEmpty(recording, "episode_title"));
       PVR_STRCPY(tag.strPlot,
           hasDetails ? detailIterator->second.description.c_str() : "");
-      PVR_STRCPY(tag.strIconPath,
-          GetStringOrEmpty(recording, "image_url").c_str());
+      PVR_STRCPY(tag.strIconPath, GetCStringOrEmpty(recording, "image_url"));
       tag.iChannelUid = channel.iUniqueId;
       PVR_STRCPY(tag.strChannelName, channel.name.c_str());
-      time_t endTime = Utils::StringToTime(
-          GetStringOrEmpty(recording, "end").c_str());
+      timeString = GetCStringOrEmpty(recording, "end", &length);
+      time_t endTime = Utils::StringToTime(timeString, length);
       tag.recordingTime = startTime;
       tag.iDuration = static_cast<int>(endTime - startTime);
 
@@ -1279,8 +2127,9 @@ int ZatData::GetRecordingsAmount(bool future)
       itr != recordings.End(); ++itr)
   {
     const Value& recording = (*itr);
-    time_t startTime = Utils::StringToTime(
-        GetStringOrEmpty(recording, "start"));
+    size_t length;
+    const char *start = GetCStringOrEmpty(recording, "start", &length);
+    time_t startTime = Utils::StringToTime(start, length);
     if (future == (startTime > current_time))
     {
       count++;
@@ -1291,21 +2140,22 @@ int ZatData::GetRecordingsAmount(bool future)
 
 std::string ZatData::GetRecordingStreamUrl(const std::string& recordingId)
 {
+  std::string key = WatchUrlCache::Key("recording:" + recordingId,
+      m_streamType, 0);
+  std::string url;
+  if (m_watchUrls.Get(key, url))
+  {
+    XBMC->Log(LOG_DEBUG, "Use cached url for recording %s",
+        recordingId.c_str());
+    return url;
+  }
+
   XBMC->Log(LOG_DEBUG, "Get url for recording %s", recordingId.c_str());
 
   std::ostringstream dataStream;
   dataStream << "recording_id=" << recordingId << "&stream_type=" << m_streamType;
 
-  std::string jsonString = HttpPost(m_providerUrl + "/zapi/watch", dataStream.str());
-
-  Document doc;
-  doc.Parse(jsonString.c_str());
-  if (doc.GetParseError() || !doc["success"].GetBool())
-  {
-    return "";
-  }
-
-  std::string url = GetStringOrEmpty(doc["stream"], "url");
+  url = WatchRequest(m_providerUrl + "/zapi/watch", dataStream.str(), key);
   XBMC->Log(LOG_DEBUG, "Got url: %s", url.c_str());
   return url;
 
@@ -1358,13 +2208,18 @@ bool ZatData::IsPlayable(const EPG_TAG *tag)
 
 int ZatData::GetRecallSeconds(const EPG_TAG *tag)
 {
-  if (m_recallEnabled)
+  ZatSession session = GetSession();
+  if (session.recallEnabled)
   {
-    return static_cast<int>(m_maxRecallSeconds);
+    return static_cast<int>(session.maxRecallSeconds);
   }
-  if (m_selectiveRecallEnabled)
+  if (session.selectiveRecallEnabled)
   {
-    ZatChannel channel = m_channelsByUid[tag->iUniqueChannelId];
+    ZatChannel channel;
+    if (!FindChannel(tag->iUniqueChannelId, channel))
+    {
+      return 0;
+    }
     return channel.selectiveRecallSeconds;
   }
   return 0;
@@ -1372,12 +2227,13 @@ int ZatData::GetRecallSeconds(const EPG_TAG *tag)
 
 bool ZatData::IsRecordable(const EPG_TAG *tag)
 {
-  if (!m_recordingEnabled)
+  if (!GetSession().recordingEnabled)
   {
     return false;
   }
-  ZatChannel channel = m_channelsByUid[tag->iUniqueChannelId];
-  if (!channel.recordingEnabled)
+  ZatChannel channel;
+  if (!FindChannel(tag->iUniqueChannelId, channel)
+      || !channel.recordingEnabled)
   {
     return false;
   }
@@ -1394,7 +2250,11 @@ bool ZatData::IsRecordable(const EPG_TAG *tag)
 std::string ZatData::GetEpgTagUrl(const EPG_TAG *tag)
 {
   std::ostringstream dataStream;
-  ZatChannel channel = m_channelsByUid[tag->iUniqueChannelId];
+  ZatChannel channel;
+  if (!FindChannel(tag->iUniqueChannelId, channel))
+  {
+    return "";
+  }
   char timeStart[sizeof "2011-10-08T07:07:09Z"];
   struct tm tm
   { };
@@ -1404,45 +2264,69 @@ std::string ZatData::GetEpgTagUrl(const EPG_TAG *tag)
   gmtime_r(&tag->endTime, &tm);
   strftime(timeEnd, sizeof timeEnd, "%FT%TZ", &tm);
 
-  std::string jsonString;
+  std::string key = WatchUrlCache::Key(
+      "broadcast:" + channel.cid + "/" + std::to_string(tag->iUniqueBroadcastId),
+      m_streamType, 0);
+  std::string url;
+  if (m_watchUrls.Get(key, url))
+  {
+    XBMC->Log(LOG_DEBUG, "Use cached timeshift url for channel %s at %s",
+        channel.cid.c_str(), timeStart);
+    return url;
+  }
 
   XBMC->Log(LOG_DEBUG, "Get timeshift url for channel %s at %s",
       channel.cid.c_str(), timeStart);
 
-  if (m_recallEnabled)
+  ZatSession session = GetSession();
+  if (session.recallEnabled)
   {
     dataStream << "cid=" << channel.cid << "&start=" << timeStart << "&end="
         << timeEnd << "&stream_type=" << m_streamType;
-    jsonString = HttpPost(m_providerUrl + "/zapi/watch", dataStream.str());
+    url = WatchRequest(m_providerUrl + "/zapi/watch", dataStream.str(), key);
   }
-  else if (m_selectiveRecallEnabled)
+  else if (session.selectiveRecallEnabled)
   {
     dataStream << "https_watch_urls=True" << "&stream_type=" << m_streamType;
-    jsonString = HttpPost(
+    url = WatchRequest(
         m_providerUrl + "/zapi/watch/selective_recall/" + channel.cid + "/"
-            + std::to_string(tag->iUniqueBroadcastId), dataStream.str());
+            + std::to_string(tag->iUniqueBroadcastId), dataStream.str(), key);
   }
   else
   {
     return "";
   }
 
-  Document doc;
-  doc.Parse(jsonString.c_str());
-  if (doc.GetParseError() || !doc["success"].GetBool())
-  {
-    return "";
-  }
-  std::string url = GetStringOrEmpty(doc["stream"], "url");
   XBMC->Log(LOG_DEBUG, "Got url: %s", url.c_str());
   return url;
 }
 
 std::string ZatData::GetStringOrEmpty(const Value& jsonValue, const char* fieldName)
 {
-  if (!jsonValue.HasMember(fieldName) || !jsonValue[fieldName].IsString())
+  size_t length;
+  const char *value = GetCStringOrEmpty(jsonValue, fieldName, &length);
+  return std::string(value, length);
+}
+
+/*!
+ * Returns a pointer into the document, which stays valid as long as the
+ * document is not modified or destroyed.
+ */
+const char* ZatData::GetCStringOrEmpty(const Value& jsonValue,
+    const char* fieldName, size_t *length)
+{
+  Value::ConstMemberIterator member = jsonValue.FindMember(fieldName);
+  if (member == jsonValue.MemberEnd() || !member->value.IsString())
   {
+    if (length)
+    {
+      *length = 0;
+    }
     return "";
   }
-  return jsonValue[fieldName].GetString();
+  if (length)
+  {
+    *length = member->value.GetStringLength();
+  }
+  return member->value.GetString();
 }
@@ -4,31 +4,24 @@
 
 #include "client.h"
 #include "UpdateThread.h"
+#include "Scheduler.h"
 #include "categories.h"
 #include "Curl.h"
 #include <map>
+#include <set>
 #include <thread>
+#include <unordered_map>
 #include <p8-platform/threads/mutex.h>
 #include "rapidjson/document.h"
 #include "XmlTV.h"
+#include "EpgStore.h"
+#include "WatchUrlCache.h"
 
 /*!
  * @brief PVR macros for std::string exchange
  */
 #define PVR_STRCPY(dest, source) do { strncpy(dest, source, sizeof(dest)-1); (dest)[sizeof(dest)-1] = '\0'; } while(0)
 
-struct PVRIptvEpgEntry
-{
-  int iBroadcastId;
-  int iChannelId;
-  time_t startTime;
-  time_t endTime;
-  std::string strTitle;
-  std::string strPlot;
-  std::string strIconPath;
-  std::string strGenreString;
-};
-
 struct ZatChannel
 {
   int iUniqueId;
@@ -38,6 +31,17 @@ struct ZatChannel
   std::string name;
   std::string strLogoPath;
   std::string cid;
+  std::string iconPath;
+
+  bool operator==(const ZatChannel& other) const
+  {
+    return iUniqueId == other.iUniqueId
+        && iChannelNumber == other.iChannelNumber
+        && selectiveRecallSeconds == other.selectiveRecallSeconds
+        && recordingEnabled == other.recordingEnabled && name == other.name
+        && strLogoPath == other.strLogoPath && cid == other.cid
+        && iconPath == other.iconPath;
+  }
 };
 
 struct ZatRecordingData
@@ -54,10 +58,29 @@ struct ZatRecordingDetails
   std::string description;
 };
 
+/*!
+ * @brief Account properties of the current session
+ */
+struct ZatSession
+{
+  std::string powerHash;
+  std::string countryCode;
+  std::string serviceRegionCountry;
+  bool recallEnabled = false;
+  bool selectiveRecallEnabled = false;
+  bool recordingEnabled = false;
+  int64_t maxRecallSeconds = 0;
+};
+
 struct PVRZattooChannelGroup
 {
   std::string name;
   std::vector<ZatChannel> channels;
+
+  bool operator==(const PVRZattooChannelGroup& other) const
+  {
+    return name == other.name && channels == other.channels;
+  }
 };
 
 class ZatData
@@ -65,10 +88,12 @@ class ZatData
 public:
   ZatData(const std::string& username, const std::string& password, bool favoritesOnly,
       bool m_alternativeEpgService, const std::string& streamType, int provider,
-      const std::string& xmlTVFile);
+      const std::string& xmlTVFile, bool xmlTVPreferred, int epgWorkers);
   ~ZatData();
   bool Initialize();
+  void InitializeAsync();
   bool LoadChannels();
+  bool LoadChannelSnapshot();
   void GetAddonCapabilities(PVR_ADDON_CAPABILITIES* pCapabilities);
   int GetChannelsAmount();
   PVR_ERROR GetChannels(ADDON_HANDLE handle, bool bRadio);
@@ -76,8 +101,8 @@ public:
   PVR_ERROR GetChannelGroups(ADDON_HANDLE handle);
   PVR_ERROR GetChannelGroupMembers(ADDON_HANDLE handle,
       const PVR_CHANNEL_GROUP &group);
-  void GetEPGForChannel(const PVR_CHANNEL &channel, time_t iStart,
-      time_t iEnd);
+  void GetEPGForChannel(ADDON_HANDLE handle, const PVR_CHANNEL &channel,
+      time_t iStart, time_t iEnd);
   void GetEPGForChannelAsync(int uniqueChannelId, time_t iStart,
       time_t iEnd);
   std::string GetChannelStreamUrl(int uniqueId);
@@ -96,44 +121,73 @@ public:
   std::string GetEpgTagUrl(const EPG_TAG *tag);
   bool RecordingEnabled()
   {
-    return m_recordingEnabled;
+    return GetSession().recordingEnabled;
   }
 
 private:
   bool m_alternativeEpgService;
+  bool m_xmlTVPreferred;
   bool m_favoritesOnly;
   std::string m_streamType;
   std::string m_username;
   std::string m_password;
   std::string m_appToken;
-  std::string m_powerHash;
-  std::string m_countryCode;
-  std::string m_serviceRegionCountry;
-  bool m_recallEnabled = false;
-  bool m_selectiveRecallEnabled = false;
-  bool m_recordingEnabled = false;
+  // Replaced as a whole under m_sessionDataMutex, readers take a copy
+  ZatSession m_session;
   std::vector<PVRZattooChannelGroup> m_channelGroups;
   std::map<int, ZatChannel> m_channelsByUid;
   std::map<std::string, ZatChannel> m_channelsByCid;
+  P8PLATFORM::CMutex m_channelsMutex;
+  std::set<std::string> m_homeLogos;
+  std::set<std::string> m_systemLogos;
+  bool m_logoIndexLoaded = false;
   std::map<std::string, ZatRecordingData*> m_recordingsData;
-  int64_t m_maxRecallSeconds = 0;
   std::string m_beakerSessionId;
   std::string m_pzuid;
+  P8PLATFORM::CMutex m_cookieMutex;
+  // Serializes logins, m_sessionDataMutex only guards m_session itself
+  P8PLATFORM::CMutex m_sessionMutex;
+  P8PLATFORM::CMutex m_sessionDataMutex;
+  P8PLATFORM::CEvent m_sessionReady{false};
+  bool m_startupFailed = false;
+  // Replays neither read nor write cookies, cache, snapshot or guide files
+  bool m_replaying = false;
   std::vector<UpdateThread*> m_updateThreads;
+  P8PLATFORM::CMutex m_updateThreadsMutex;
+  unsigned int m_maxUpdateThreads;
+  Scheduler *m_scheduler = nullptr;
   std::string m_uuid = "";
   Categories m_categories;
   std::string m_providerUrl;
   bool m_recordingsLoaded = false;
   XmlTV *m_xmlTV = nullptr;
+  EpgStore m_epgStore;
+  std::unordered_map<unsigned int, int> m_genresById;
+  std::shared_ptr<StringPool> m_genresPool;
+  P8PLATFORM::CMutex m_genresMutex;
+  WatchUrlCache m_watchUrls;
 
   bool LoadAppId();
   bool ReadDataJson();
   bool WriteDataJson();
   std::string GetUUID();
   std::string GenerateUUID();
+  std::string GetSessionAccount();
   bool SendHello(std::string uuid);
   rapidjson::Document Login();
+  bool StartSession();
+  void RefreshSessionAndChannels();
   bool InitSession();
+  bool ResumeSession();
+  void ApplySession(const rapidjson::Value& session);
+  ZatSession GetSession();
+  static bool IsLoggedIn(const rapidjson::Document& doc);
+  void KeepSessionAlive();
+  void RefreshRecordings();
+  void RefreshEpg();
+  void ScheduleTasks();
+  void SaveEpgDatabase();
+  void PruneEpgStore();
   std::string HttpGetCached(const std::string& url, time_t cacheDuration, const std::string& userAgent = "");
   std::string HttpGet(const std::string& url, bool isInit = false, const std::string& userAgent = "");
   std::string HttpDelete(const std::string& url, bool isInit = false);
@@ -141,12 +195,36 @@ private:
   std::string HttpRequest(const std::string& action, const std::string& url, const std::string& postData, bool isInit, const std::string& userAgent);
   std::string HttpRequestToCurl(Curl &curl, const std::string& action, const std::string& url,
                            const std::string& postData, int &statusCode);
-  std::map<time_t, PVRIptvEpgEntry>* LoadEPG(time_t iStart, time_t iEnd,
-      int uniqueChannelId);
-  ZatChannel* FindChannel(int uniqueId);
+  bool LoadEPG(time_t iStart, time_t iEnd,
+      const std::vector<PVRIptvEpgEntry> *covered = nullptr);
+  int ResolveGenre(const std::shared_ptr<StringPool>& strings,
+      unsigned int genreId);
+  int TransferEpgEntries(ADDON_HANDLE handle, int uniqueChannelId,
+      time_t iStart, time_t iEnd,
+      const std::vector<PVRIptvEpgEntry> &xmlTVEntries =
+          std::vector<PVRIptvEpgEntry>(),
+      const std::shared_ptr<const StringPool> &xmlTVStrings = nullptr);
+  std::string ChannelWatchUrlKey(const std::string& cid);
+  std::string FetchChannelStreamUrl(const std::string& cid);
+  std::string WatchRequest(const std::string& url, const std::string& postData,
+      const std::string& cacheKey);
+  void PrefetchChannelStreamUrls(int uniqueId);
+  void ApplyChannels(std::vector<PVRZattooChannelGroup>& channelGroups,
+      std::map<int, ZatChannel>& channelsByUid,
+      std::map<std::string, ZatChannel>& channelsByCid);
+  void ResolveIconPaths(std::vector<PVRZattooChannelGroup>& channelGroups,
+      std::map<int, ZatChannel>& channelsByUid,
+      std::map<std::string, ZatChannel>& channelsByCid);
+  static void ListLogos(const char *directory, std::set<std::string>& logos);
+  void SaveChannelSnapshot();
+  bool FindChannel(int uniqueId, ZatChannel& channel);
+  bool FindChannelByCid(const std::string& cid, ZatChannel& channel);
   PVRZattooChannelGroup* FindGroup(const std::string& strName);
   int GetChannelId(const char * strChannelName);
   void GetEPGForChannelExternalService(int uniqueChannelId,
       time_t iStart, time_t iEnd);
   std::string GetStringOrEmpty(const rapidjson::Value& jsonValue, const char* fieldName);
+  static const char* GetCStringOrEmpty(const rapidjson::Value& jsonValue,
+      const char* fieldName, size_t *length = nullptr);
+  void ScaleUpdateThreads();
 };
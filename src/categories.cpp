@@ -39,6 +39,7 @@ Categories::Categories() :
 {
   char *saveptr;
   LoadEITCategories();
+  m_categoriesByName.reserve(m_categoriesById.size() * 2);
   // Copy over
   CategoryByIdMap::const_iterator it;
   for (it = m_categoriesById.begin(); it != m_categoriesById.end(); ++it)
@@ -75,7 +76,10 @@ int Categories::Category(const std::string& category) const
   auto it = m_categoriesByName.find(category);
   if (it != m_categoriesByName.end())
     return it->second;
-  XBMC->Log(LOG_NOTICE, "Missing category: %s", category.c_str());
+  // Unknown genres are logged only the first time they show up
+  P8PLATFORM::CLockObject lock(m_missingCategoriesMutex);
+  if (m_missingCategories.insert(category).second)
+    XBMC->Log(LOG_NOTICE, "Missing category: %s", category.c_str());
   return 0;
 }
 
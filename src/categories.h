@@ -23,9 +23,12 @@
 
 #include <string>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <p8-platform/threads/mutex.h>
 
 typedef std::multimap<int, std::string> CategoryByIdMap;
-typedef std::map<std::string, int> CategoryByNameMap;
+typedef std::unordered_map<std::string, int> CategoryByNameMap;
 
 class Categories
 {
@@ -40,4 +43,6 @@ private:
 
   CategoryByIdMap m_categoriesById;
   CategoryByNameMap m_categoriesByName;
+  mutable std::unordered_set<std::string> m_missingCategories;
+  mutable P8PLATFORM::CMutex m_missingCategoriesMutex;
 };
@@ -1,5 +1,7 @@
 #include "client.h"
 #include "ZatData.h"
+#include "Metrics.h"
+#include "Trace.h"
 #include "kodi/xbmc_pvr_dll.h"
 #include "kodi/libKODI_guilib.h"
 #include <chrono>
@@ -18,6 +20,7 @@ using namespace ADDON;
 
 ADDON_STATUS m_CurStatus = ADDON_STATUS_UNKNOWN;
 ZatData *zat = nullptr;
+const unsigned int MENUHOOK_STATISTICS = 1;
 
 /* User adjustable settings are saved here.
  * Default values are defined inside client.h
@@ -35,7 +38,13 @@ bool zatFavoritesOnly = false;
 bool zatAlternativeEpgService = false;
 bool streamType = false;
 std::string xmlTVFile;
+int xmlTVPrecedence = 0;
 int provider = 0;
+int epgWorkers = 0;
+bool trace = false;
+int trafficMode = 0;
+int replayLatency = 0;
+int replayBandwidth = 0;
 int runningRequests = 0;
 
 extern "C"
@@ -71,10 +80,34 @@ void ADDON_ReadSettings(void)
   {
     xmlTVFile = buffer;
   }
+  if (XBMC->GetSetting("xmltvprecedence", &intBuffer))
+  {
+    xmlTVPrecedence = intBuffer;
+  }
   if (XBMC->GetSetting("provider", &intBuffer))
   {
     provider = intBuffer;
   }
+  if (XBMC->GetSetting("epgworkers", &intBuffer))
+  {
+    epgWorkers = intBuffer;
+  }
+  if (XBMC->GetSetting("trace", &boolBuffer))
+  {
+    trace = boolBuffer;
+  }
+  if (XBMC->GetSetting("trafficmode", &intBuffer))
+  {
+    trafficMode = intBuffer;
+  }
+  if (XBMC->GetSetting("replaylatency", &intBuffer))
+  {
+    replayLatency = intBuffer;
+  }
+  if (XBMC->GetSetting("replaybandwidth", &intBuffer))
+  {
+    replayBandwidth = intBuffer;
+  }
   XBMC->Log(LOG_DEBUG, "End Readsettings");
 }
 
@@ -114,13 +147,25 @@ ADDON_STATUS ADDON_Create(void *hdl, void *props)
   zatUsername = "";
   zatPassword = "";
   ADDON_ReadSettings();
-  if (!zatUsername.empty() && !zatPassword.empty())
+  Trace::SetEnabled(trace);
+  Curl::SetTrafficMode(static_cast<TrafficMode>(trafficMode), replayLatency,
+      replayBandwidth);
+  // Recorded traffic has the credentials scrubbed, it replays without them
+  if ((!zatUsername.empty() && !zatPassword.empty())
+      || trafficMode == TRAFFIC_REPLAY)
   {
     XBMC->Log(LOG_DEBUG, "Create Zat");
     zat = new ZatData(zatUsername, zatPassword, zatFavoritesOnly,
-        zatAlternativeEpgService, streamType ? "hls" : "dash", provider, xmlTVFile);
+        zatAlternativeEpgService, streamType ? "hls" : "dash", provider, xmlTVFile,
+        xmlTVPrecedence == 0, epgWorkers);
     XBMC->Log(LOG_DEBUG, "Zat created");
-    if (zat->Initialize() && zat->LoadChannels())
+    if (zat->LoadChannelSnapshot())
+    {
+      // Channels are served from the snapshot while the session starts
+      zat->InitializeAsync();
+      m_CurStatus = ADDON_STATUS_OK;
+    }
+    else if (zat->Initialize() && zat->LoadChannels())
     {
       m_CurStatus = ADDON_STATUS_OK;
     }
@@ -128,6 +173,13 @@ ADDON_STATUS ADDON_Create(void *hdl, void *props)
     {
       XBMC->QueueNotification(QUEUE_ERROR, XBMC->GetLocalizedString(37111));
     }
+
+    PVR_MENUHOOK hook;
+    memset(&hook, 0, sizeof(PVR_MENUHOOK));
+    hook.iHookId = MENUHOOK_STATISTICS;
+    hook.iLocalizedStringId = 37110;
+    hook.category = PVR_MENUHOOK_SETTING;
+    PVR->AddMenuHook(&hook);
   }
 
   return m_CurStatus;
@@ -150,6 +202,7 @@ void ADDON_Destroy()
     waitCount--;
   }
   SAFE_DELETE(oldZat);
+  Trace::SetEnabled(false);
   SAFE_DELETE(PVR);
   SAFE_DELETE(XBMC);
   m_CurStatus = ADDON_STATUS_UNKNOWN;
@@ -207,6 +260,16 @@ ADDON_STATUS ADDON_SetSetting(const char *settingName, const void *settingValue)
     }
   }
   
+  if (name == "epgworkers")
+  {
+    int workers = *static_cast<const int*>(settingValue);
+    if (epgWorkers != workers)
+    {
+      epgWorkers = workers;
+      return ADDON_STATUS_NEED_RESTART;
+    }
+  }
+
   if (name == "xmlTVFile")
   {
     std::string xmlTVFileProp = static_cast<const char*>(settingValue);
@@ -216,6 +279,35 @@ ADDON_STATUS ADDON_SetSetting(const char *settingName, const void *settingValue)
       return ADDON_STATUS_NEED_RESTART;
     }
   }
+
+  if (name == "trace")
+  {
+    trace = *static_cast<const bool*>(settingValue);
+    Trace::SetEnabled(trace);
+  }
+
+  if (name == "trafficmode" || name == "replaylatency"
+      || name == "replaybandwidth")
+  {
+    int value = *static_cast<const int*>(settingValue);
+    int &current = name == "trafficmode" ? trafficMode :
+        name == "replaylatency" ? replayLatency : replayBandwidth;
+    if (current != value)
+    {
+      current = value;
+      return ADDON_STATUS_NEED_RESTART;
+    }
+  }
+
+  if (name == "xmltvprecedence")
+  {
+    int precedence = *static_cast<const int*>(settingValue);
+    if (xmlTVPrecedence != precedence)
+    {
+      xmlTVPrecedence = precedence;
+      return ADDON_STATUS_NEED_RESTART;
+    }
+  }
   
   return ADDON_STATUS_OK;
 }
@@ -297,7 +389,7 @@ PVR_ERROR GetEPGForChannel(ADDON_HANDLE handle, const PVR_CHANNEL &channel,
   PVR_ERROR ret = PVR_ERROR_SERVER_ERROR;
   if (zat)
   {
-    zat->GetEPGForChannel(channel, iStart, iEnd);
+    zat->GetEPGForChannel(handle, channel, iStart, iEnd);
     ret = PVR_ERROR_NO_ERROR;
   }
   runningRequests--;
@@ -681,6 +773,12 @@ PVR_ERROR OpenDialogChannelScan(void)
 PVR_ERROR CallMenuHook(const PVR_MENUHOOK &menuhook,
     const PVR_MENUHOOK_DATA &item)
 {
+  if (menuhook.iHookId == MENUHOOK_STATISTICS)
+  {
+    Metrics::Dump();
+    XBMC->QueueNotification(QUEUE_INFO, XBMC->GetLocalizedString(37112));
+    return PVR_ERROR_NO_ERROR;
+  }
   return PVR_ERROR_NOT_IMPLEMENTED;
 }
 PVR_ERROR DeleteChannel(const PVR_CHANNEL &channel)